@@ -1,5 +1,6 @@
 ﻿using System;
 using System.Collections.Generic;
+using System.IO;
 using System.Linq;
 using System.Text;
 
@@ -158,31 +159,107 @@ namespace VNTextPatch.Shared.Util
             throw new NotSupportedException();
         }
 
+        // sjis_ext.bin layout (version 2). VNTextProxy maps the file into memory as-is, so everything it needs at runtime
+        // is precomputed here:
+        //   header:  "SJEX", version, mapping count, reverse table size (power of two), forward table offset, reverse table offset
+        //   forward: one UTF-16 char per mapping index
+        //   reverse: open-addressing hash (linear probing) of { char, mapping index + 1 } pairs; an index of 0 marks an empty entry
+        // Version 1 files are just the forward table and can still be read.
+        private const uint MappingTableMagic = 0x58454A53;
+        private const int MappingTableVersion = 2;
+        private const int MappingTableHeaderSize = 0x18;
+
         public byte[] GetMappingTable()
         {
-            byte[] table = new byte[_mappings.Count * 2];
-            int byteIdx = 0;
+            if (_mappings.Count == 0)
+                return new byte[0];
+
+            int reverseTableBits = 4;
+            while ((1 << reverseTableBits) < _mappings.Count * 2)
+            {
+                reverseTableBits++;
+            }
+
+            int reverseTableSize = 1 << reverseTableBits;
+            ushort[] reverseTable = new ushort[reverseTableSize * 2];
+            int mappingIdx = 0;
+            foreach (char c in _mappings.Keys)
+            {
+                int entryIdx = GetMappingTableHash(c, reverseTableBits);
+                while (reverseTable[entryIdx * 2 + 1] != 0)
+                {
+                    entryIdx = (entryIdx + 1) & (reverseTableSize - 1);
+                }
+
+                reverseTable[entryIdx * 2] = c;
+                reverseTable[entryIdx * 2 + 1] = (ushort)(mappingIdx + 1);
+                mappingIdx++;
+            }
+
+            int forwardTableOffset = MappingTableHeaderSize;
+            int reverseTableOffset = (forwardTableOffset + _mappings.Count * 2 + 3) & ~3;
+
+            MemoryStream stream = new MemoryStream();
+            BinaryWriter writer = new BinaryWriter(stream);
+            writer.Write(MappingTableMagic);
+            writer.Write(MappingTableVersion);
+            writer.Write(_mappings.Count);
+            writer.Write(reverseTableSize);
+            writer.Write(forwardTableOffset);
+            writer.Write(reverseTableOffset);
+
             foreach (char c in _mappings.Keys)
             {
-                table[byteIdx++] = (byte)c;
-                table[byteIdx++] = (byte)(c >> 8);
+                writer.Write((ushort)c);
             }
-            return table;
+
+            writer.Write(new byte[reverseTableOffset - (int)stream.Position]);
+            foreach (ushort value in reverseTable)
+            {
+                writer.Write(value);
+            }
+
+            writer.Flush();
+            return stream.ToArray();
         }
 
         public void SetMappingTable(byte[] table)
         {
-            if (table.Length % 2 != 0)
-                throw new ArgumentException();
+            int forwardTableOffset = 0;
+            int numMappings;
+            if (table.Length >= MappingTableHeaderSize && BitConverter.ToUInt32(table, 0) == MappingTableMagic)
+            {
+                if (BitConverter.ToInt32(table, 4) != MappingTableVersion)
+                    throw new InvalidDataException("Unsupported sjis_ext.bin version");
+
+                numMappings = BitConverter.ToInt32(table, 8);
+                forwardTableOffset = BitConverter.ToInt32(table, 0x10);
+                if (numMappings < 0 || forwardTableOffset < MappingTableHeaderSize || forwardTableOffset + numMappings * 2 > table.Length)
+                    throw new InvalidDataException("Corrupted sjis_ext.bin");
+            }
+            else
+            {
+                if (table.Length % 2 != 0)
+                    throw new ArgumentException();
+
+                numMappings = table.Length / 2;
+            }
 
             _mappings.Clear();
-            for (int i = 0; i < table.Length; i += 2)
+            for (int i = 0; i < numMappings; i++)
             {
-                char c = (char)(table[i] | (table[i + 1] << 8));
+                int byteIdx = forwardTableOffset + i * 2;
+                char c = (char)(table[byteIdx] | (table[byteIdx + 1] << 8));
                 GetSjisTunnelChar(c);
             }
         }
 
+        // Must match SjisTunnelEncoding::GetMappingTableHash() in VNTextProxy
+        private static int GetMappingTableHash(char c, int bits)
+        {
+            return (int)(((uint)c * 0x9E3779B1u) >> (32 - bits));
+        }
+
         private char GetSjisTunnelChar(char origChar)
         {
             if (char.IsHighSurrogate(origChar) || char.IsLowSurrogate(origChar))
@@ -1,9 +1,7 @@
 #include "pch.h"
 #include "BicubicScaler.h"
 #include "DX11Shaders.h"
-#include <d3dcompiler.h>
-
-#pragma comment(lib, "d3dcompiler.lib")
+#include "ShaderCache.h"
 
 namespace BicubicScaler
 {
@@ -36,43 +34,18 @@ namespace BicubicScaler
     {
         HRESULT hr;
 
-        // Compile vertex shader
-        ID3DBlob* pVSBlob = nullptr;
-        ID3DBlob* pErrorBlob = nullptr;
-        hr = D3DCompile(
-            g_BicubicShader,
-            strlen(g_BicubicShader),
-            "BicubicScaler",
-            nullptr,
-            nullptr,
-            "VS_Main",
-            "vs_4_0",
-            D3DCOMPILE_OPTIMIZATION_LEVEL3,
-            0,
-            &pVSBlob,
-            &pErrorBlob
-        );
-        if (FAILED(hr))
-        {
-            if (pErrorBlob)
-            {
-                OutputDebugStringA((char*)pErrorBlob->GetBufferPointer());
-                pErrorBlob->Release();
-            }
+        // Compile vertex shader (or load it from the shader cache)
+        std::vector<BYTE> vsBytecode = ShaderCache::Compile(g_BicubicShader, "BicubicScaler", "VS_Main", "vs_4_0");
+        if (vsBytecode.empty())
             return false;
-        }
 
         hr = pDevice->CreateVertexShader(
-            pVSBlob->GetBufferPointer(),
-            pVSBlob->GetBufferSize(),
+            vsBytecode.data(),
+            vsBytecode.size(),
             nullptr,
             &g_pVertexShader
         );
-        if (FAILED(hr))
-        {
-            pVSBlob->Release();
-            return false;
-        }
+        if (FAILED(hr)) return false;
 
         // Create input layout
         D3D11_INPUT_ELEMENT_DESC inputDesc[] = {
@@ -82,45 +55,23 @@ namespace BicubicScaler
         hr = pDevice->CreateInputLayout(
             inputDesc,
             2,
-            pVSBlob->GetBufferPointer(),
-            pVSBlob->GetBufferSize(),
+            vsBytecode.data(),
+            vsBytecode.size(),
             &g_pInputLayout
         );
-        pVSBlob->Release();
         if (FAILED(hr)) return false;
 
         // Compile pixel shader
-        ID3DBlob* pPSBlob = nullptr;
-        hr = D3DCompile(
-            g_BicubicShader,
-            strlen(g_BicubicShader),
-            "BicubicScaler",
-            nullptr,
-            nullptr,
-            "PS_Main",
-            "ps_4_0",
-            D3DCOMPILE_OPTIMIZATION_LEVEL3,
-            0,
-            &pPSBlob,
-            &pErrorBlob
-        );
-        if (FAILED(hr))
-        {
-            if (pErrorBlob)
-            {
-                OutputDebugStringA((char*)pErrorBlob->GetBufferPointer());
-                pErrorBlob->Release();
-            }
+        std::vector<BYTE> psBytecode = ShaderCache::Compile(g_BicubicShader, "BicubicScaler", "PS_Main", "ps_4_0");
+        if (psBytecode.empty())
             return false;
-        }
 
         hr = pDevice->CreatePixelShader(
-            pPSBlob->GetBufferPointer(),
-            pPSBlob->GetBufferSize(),
+            psBytecode.data(),
+            psBytecode.size(),
             nullptr,
             &g_pPixelShader
         );
-        pPSBlob->Release();
         if (FAILED(hr)) return false;
 
         // Create vertex buffer (fullscreen quad as two triangles)
@@ -2,70 +2,90 @@
 
 using namespace std;
 
+void CompilerHelper::RegisterSignatures()
+{
+    RichSignatureId = SignatureScanner::AddPattern(SignatureRegion::Headers, "Rich", 4);
+    BorlandSignatureId = SignatureScanner::AddPattern(SignatureRegion::Code, "Borland", 7);
+}
+
 void CompilerHelper::Init()
 {
     CompilerType = CompilerType::Unknown;
 
-    HMODULE hGame = GetModuleHandle(nullptr);
-    if (MemoryUtil::FindData((void*)hGame, 0x1000, "Rich", 4) != nullptr)
+    if (RichSignatureId < 0)
+        RegisterSignatures();
+
+    if (SignatureScanner::GetMatch(RichSignatureId) != nullptr)
     {
         CompilerType = CompilerType::Msvc;
         return;
     }
 
-    vector<PE::Section> gameSections = PE::GetSections(hGame);
-    const PE::Section& textSection = gameSections[0];
-    if (MemoryUtil::FindData(textSection.Start, textSection.Size, "Borland", 7) != nullptr)
-        CompilerType = CompilerType::Borland;    
+    if (SignatureScanner::GetMatch(BorlandSignatureId) != nullptr)
+        CompilerType = CompilerType::Borland;
 }
 
 void** CompilerHelper::FindVTable(const string& className)
 {
-    return FindVTable(GetModuleHandle(nullptr), CompilerType, className);
+    // A vtable from the cache is checked against its type descriptor before it's used, which is much cheaper than searching
+    HMODULE hGame = GetModuleHandle(nullptr);
+    string cacheKey = "vtable:" + to_string((int)CompilerType) + ":" + className;
+    void* pCachedVTable;
+    if (SignatureCache::TryGet(cacheKey, pCachedVTable))
+    {
+        if (pCachedVTable == nullptr)
+            return nullptr;
+
+        void* pModuleStart = (void*)hGame;
+        void* pModuleEnd = (BYTE*)pModuleStart + DetourGetModuleSize(hGame);
+        if (HasTypeDescriptor((void**)pCachedVTable, CompilerType, GetTypeDescriptorClassName(CompilerType, className), pModuleStart, pModuleEnd))
+            return (void**)pCachedVTable;
+    }
+
+    void** pVTable = FindVTable(hGame, CompilerType, className);
+    SignatureCache::Set(cacheKey, pVTable);
+    SignatureCache::Flush();
+    return pVTable;
 }
 
 void** CompilerHelper::FindVTable(HMODULE hModule, ::CompilerType compilerType, const std::string& className)
 {
-    void* pModuleStart = (void*)hModule;
-    void* pModuleEnd = (BYTE*)pModuleStart + DetourGetModuleSize(hModule);
-
-    vector<PE::Section> sections = PE::GetSections(hModule);
-    const PE::Section& textSection = sections[0];
-    void* pCodeStart = textSection.Start;
-    void* pCodeEnd = (BYTE*)textSection.Start + textSection.Size;
+    const RttiIndex& rttiIndex = RttiIndices.try_emplace(make_pair(hModule, compilerType), hModule, compilerType).first->second;
+    return rttiIndex.FindVTable(GetTypeDescriptorClassName(compilerType, className));
+}
 
-    string typeDescriptorClassName;
+string CompilerHelper::GetTypeDescriptorClassName(::CompilerType compilerType, const string& className)
+{
     switch (compilerType)
     {
         case CompilerType::Borland:
-            typeDescriptorClassName = className;
-            break;
+            return className;
 
         case CompilerType::Msvc:
+        {
             vector<string> parts = StringUtil::Split<char>(className, "::");
             std::ranges::reverse(parts);
-            typeDescriptorClassName = StringUtil::Join<char>(parts, "@");
-            break;
+            return StringUtil::Join<char>(parts, "@");
+        }
+
+        default:
+            return string();
     }
+}
 
-    for (int i = 1; i < sections.size(); i++)
+bool CompilerHelper::HasTypeDescriptor(void** pVTable, ::CompilerType compilerType, const string& className, void* pModuleStart, void* pModuleEnd)
+{
+    switch (compilerType)
     {
-        const PE::Section& section = sections[i];
-        void* pSectionStart = section.Start;
-        void* pSectionEnd = (BYTE*)section.Start + section.Size;
-        for (void** ppFunc = (void**)pSectionStart + 3; ppFunc < pSectionEnd; ppFunc++)
-        {
-            if (*ppFunc < pCodeStart || *ppFunc >= pCodeEnd)
-                continue;
+        case CompilerType::Borland:
+            return HasBorlandTypeDescriptor(pVTable, className, pModuleStart, pModuleEnd);
 
-            if (compilerType == CompilerType::Borland && HasBorlandTypeDescriptor(ppFunc, typeDescriptorClassName, pModuleStart, pModuleEnd))
-                return ppFunc;
+        case CompilerType::Msvc:
+            return HasMsvcTypeDescriptor(pVTable, className, pModuleStart, pModuleEnd);
 
-            if (compilerType == CompilerType::Msvc && HasMsvcTypeDescriptor(ppFunc, typeDescriptorClassName, pModuleStart, pModuleEnd))
-                return ppFunc;
-        }
+        default:
+            return false;
     }
-    return nullptr;
 }
 
 bool CompilerHelper::HasBorlandTypeDescriptor(void** pVTable, const string& className, void* pModuleStart, void* pModuleEnd)
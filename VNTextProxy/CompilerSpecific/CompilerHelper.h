@@ -3,6 +3,7 @@
 class CompilerHelper
 {
 public:
+    static void         RegisterSignatures          ();
     static void         Init                        ();
 
     static void**       FindVTable                  (const std::string& className);
@@ -11,6 +12,14 @@ public:
     static inline CompilerType CompilerType{};
 
 private:
+    static std::string  GetTypeDescriptorClassName  (::CompilerType compilerType, const std::string& className);
+    static bool         HasTypeDescriptor           (void** pVTable, ::CompilerType compilerType, const std::string& className, void* pModuleStart, void* pModuleEnd);
     static bool         HasBorlandTypeDescriptor    (void** pVTable, const std::string& className, void* pModuleStart, void* pModuleEnd);
     static bool         HasMsvcTypeDescriptor       (void** pVTable, const std::string& className, void* pModuleStart, void* pModuleEnd);
+
+    // Built on the first lookup in a module, so every further lookup is just a hash map access
+    static inline std::map<std::pair<HMODULE, ::CompilerType>, RttiIndex> RttiIndices{};
+
+    static inline int   RichSignatureId = -1;
+    static inline int   BorlandSignatureId = -1;
 };
@@ -0,0 +1,93 @@
+#include "pch.h"
+
+using namespace std;
+
+RttiIndex::RttiIndex(HMODULE hModule, CompilerType compilerType)
+{
+    if (compilerType != CompilerType::Msvc && compilerType != CompilerType::Borland)
+        return;
+
+    void* pModuleStart = (void*)hModule;
+    void* pModuleEnd = (BYTE*)pModuleStart + DetourGetModuleSize(hModule);
+
+    vector<PE::Section> sections = PE::GetSections(hModule);
+    const PE::Section& textSection = sections[0];
+    void* pCodeStart = textSection.Start;
+    void* pCodeEnd = (BYTE*)textSection.Start + textSection.Size;
+
+    for (int i = 1; i < sections.size(); i++)
+    {
+        const PE::Section& section = sections[i];
+        void* pSectionStart = section.Start;
+        void* pSectionEnd = (BYTE*)section.Start + section.Size;
+        for (void** ppFunc = (void**)pSectionStart + 3; ppFunc < pSectionEnd; ppFunc++)
+        {
+            if (*ppFunc < pCodeStart || *ppFunc >= pCodeEnd)
+                continue;
+
+            if (compilerType == CompilerType::Msvc)
+                AddMsvcVTable(ppFunc, pModuleStart, pModuleEnd);
+            else
+                AddBorlandVTable(ppFunc, pModuleStart, pModuleEnd);
+        }
+    }
+}
+
+void** RttiIndex::FindVTable(const string& typeDescriptorClassName) const
+{
+    auto it = _vtables.find(typeDescriptorClassName);
+    return it != _vtables.end() ? it->second : nullptr;
+}
+
+void RttiIndex::AddMsvcVTable(void** pVTable, void* pModuleStart, void* pModuleEnd)
+{
+    MsvcRttiCompleteObjectLocator* pLocator = (MsvcRttiCompleteObjectLocator*)pVTable[-1];
+    if (pLocator < pModuleStart || pLocator >= pModuleEnd || pLocator + 1 > pModuleEnd ||
+        pLocator->Signature != 0 ||
+        pLocator->pTypeDescriptor < pModuleStart || pLocator->pTypeDescriptor >= pModuleEnd || pLocator->pTypeDescriptor + 1 > pModuleEnd)
+    {
+        return;
+    }
+
+    // Decorated names look like ".?AVclass@namespace@@"; the index is keyed on the part in between
+    const char* pRttiClassName = pLocator->pTypeDescriptor->raw_name();
+    if (pRttiClassName < pModuleStart || pRttiClassName + 4 > pModuleEnd || memcmp(pRttiClassName, ".?A", 3) != 0)
+        return;
+
+    int maxLength = (const char*)pModuleEnd - pRttiClassName;
+    int length = strnlen(pRttiClassName, maxLength);
+    if (length == maxLength || length < 6 || memcmp(pRttiClassName + length - 2, "@@", 2) != 0)
+        return;
+
+    AddVTable(pRttiClassName + 4, length - 6, pVTable);
+}
+
+void RttiIndex::AddBorlandVTable(void** pVTable, void* pModuleStart, void* pModuleEnd)
+{
+    BorlandTypeDescriptor* pTypeDescriptor = (BorlandTypeDescriptor*)pVTable[-3];
+    if (pTypeDescriptor < pModuleStart || pTypeDescriptor >= pModuleEnd || pTypeDescriptor->Name >= pModuleEnd)
+        return;
+
+    // Any pointer to code can look like a vtable, and unlike MSVC's there's no signature to weed out the ones that aren't,
+    // so only accept descriptors whose name looks like a C++ identifier
+    const char* pName = pTypeDescriptor->Name;
+    int maxLength = (const char*)pModuleEnd - pName;
+    int length = strnlen(pName, maxLength);
+    if (length == 0 || length == maxLength)
+        return;
+
+    for (int i = 0; i < length; i++)
+    {
+        char c = pName[i];
+        if (!isalnum((BYTE)c) && c != '_' && c != ':' && c != '<' && c != '>' && c != ',' && c != ' ' && c != '*' && c != '&')
+            return;
+    }
+
+    AddVTable(pName, length, pVTable);
+}
+
+void RttiIndex::AddVTable(const char* pClassName, int classNameLength, void** pVTable)
+{
+    // Keep the first vtable for each class, which is the one a linear search would have found
+    _vtables.try_emplace(string(pClassName, classNameLength), pVTable);
+}
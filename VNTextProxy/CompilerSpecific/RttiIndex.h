@@ -0,0 +1,19 @@
+#pragma once
+
+// Maps the class names of all RTTI type descriptors in a module to their vtables. Building it takes a single sweep over the
+// module's data sections (the same one that finding a single vtable used to take), after which any class can be looked up directly.
+class RttiIndex
+{
+public:
+    RttiIndex(HMODULE hModule, CompilerType compilerType);
+
+    // Takes the class name in the form it has in the type descriptor (see CompilerHelper::GetTypeDescriptorClassName())
+    void** FindVTable(const std::string& typeDescriptorClassName) const;
+
+private:
+    void AddMsvcVTable(void** pVTable, void* pModuleStart, void* pModuleEnd);
+    void AddBorlandVTable(void** pVTable, void* pModuleStart, void* pModuleEnd);
+    void AddVTable(const char* pClassName, int classNameLength, void** pVTable);
+
+    std::unordered_map<std::string, void**> _vtables;
+};
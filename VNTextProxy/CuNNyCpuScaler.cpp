@@ -0,0 +1,865 @@
+// Deliberately doesn't include pch.h (and thus windows.h); see CuNNyCpuScaler.h
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__)
+#define CUNNYCPU_AVX2 1
+#include <immintrin.h>
+#elif defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define CUNNYCPU_SSE2 1
+#include <immintrin.h>
+#endif
+
+#include "CuNNyCpuScaler.h"
+#include "CuNNyShaderSource.h"
+#include "DX11Shaders.h"
+#include "Util/FrameCopy.h"
+
+using namespace std;
+
+namespace CuNNyCpuScaler
+{
+    // The convolutions work on VecWidth pixels of one channel at a time
+#if CUNNYCPU_AVX2
+    typedef __m256 FloatVec;
+    static constexpr int VecWidth = 8;
+    static FloatVec VecLoad(const float* p) { return _mm256_loadu_ps(p); }
+    static void VecStore(float* p, FloatVec v) { _mm256_storeu_ps(p, v); }
+    static FloatVec VecSet(float f) { return _mm256_set1_ps(f); }
+    static FloatVec VecMin(FloatVec a, FloatVec b) { return _mm256_min_ps(a, b); }
+    static FloatVec VecMax(FloatVec a, FloatVec b) { return _mm256_max_ps(a, b); }
+    static FloatVec VecSqrt(FloatVec a) { return _mm256_sqrt_ps(a); }
+#if defined(__FMA__) || defined(_MSC_VER)
+    static FloatVec VecMulAdd(FloatVec a, FloatVec b, FloatVec c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+    static FloatVec VecMulAdd(FloatVec a, FloatVec b, FloatVec c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+#elif CUNNYCPU_SSE2
+    typedef __m128 FloatVec;
+    static constexpr int VecWidth = 4;
+    static FloatVec VecLoad(const float* p) { return _mm_loadu_ps(p); }
+    static void VecStore(float* p, FloatVec v) { _mm_storeu_ps(p, v); }
+    static FloatVec VecSet(float f) { return _mm_set1_ps(f); }
+    static FloatVec VecMin(FloatVec a, FloatVec b) { return _mm_min_ps(a, b); }
+    static FloatVec VecMax(FloatVec a, FloatVec b) { return _mm_max_ps(a, b); }
+    static FloatVec VecSqrt(FloatVec a) { return _mm_sqrt_ps(a); }
+    static FloatVec VecMulAdd(FloatVec a, FloatVec b, FloatVec c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+#else
+    typedef float FloatVec;
+    static constexpr int VecWidth = 1;
+    static FloatVec VecLoad(const float* p) { return *p; }
+    static void VecStore(float* p, FloatVec v) { *p = v; }
+    static FloatVec VecSet(float f) { return f; }
+    static FloatVec VecMin(FloatVec a, FloatVec b) { return min(a, b); }
+    static FloatVec VecMax(FloatVec a, FloatVec b) { return max(a, b); }
+    static FloatVec VecSqrt(FloatVec a) { return sqrt(a); }
+    static FloatVec VecMulAdd(FloatVec a, FloatVec b, FloatVec c) { return a * b + c; }
+#endif
+
+    static constexpr int NumPasses = 4;
+    static constexpr int NumTaps = 9;
+
+    // Channel counts of the passes' inputs and outputs, as the fixed code in this file expects them
+    static constexpr int PassInputChannels[NumPasses] = { 1, 12, 12, 8 };
+    static constexpr int PassOutputChannels[NumPasses] = { 12, 12, 8, 4 };
+
+    // 3x3 convolution weights of one pass, stored as [input channel][tap][output channel] so that the weights
+    // applied to one input sample are next to each other. Taps are numbered row by row from the top left.
+    struct PassWeights
+    {
+        int NumInputs = 0;
+        int NumOutputs = 0;
+        vector<float> Weights;
+        vector<float> Biases;
+    };
+
+    // One or more planar float images with a 1 pixel border that repeats the edge pixels, so that the convolutions
+    // can read the 3x3 neighbourhood of any pixel like the shaders' clamping sampler does. Rows have room for
+    // VecWidth extra pixels so the last vector of a row can run past the edge.
+    struct FeatureMap
+    {
+        int NumChannels = 0;
+        int Width = 0;
+        int Height = 0;
+        int Stride = 0;
+        vector<float> Data;
+
+        void Resize(int numChannels, int width, int height)
+        {
+            NumChannels = numChannels;
+            Width = width;
+            Height = height;
+            Stride = width + 2 + VecWidth;
+            Data.assign((size_t)numChannels * Stride * (height + 2), 0.0f);
+        }
+
+        // Returns the first pixel of a row; row -1 and column -1 are part of the border
+        float* Row(int channel, int y)
+        {
+            return &Data[((size_t)channel * (Height + 2) + y + 1) * Stride + 1];
+        }
+
+        const float* Row(int channel, int y) const
+        {
+            return &Data[((size_t)channel * (Height + 2) + y + 1) * Stride + 1];
+        }
+
+        void FillBorder()
+        {
+            for (int channel = 0; channel < NumChannels; channel++)
+            {
+                for (int y = 0; y < Height; y++)
+                {
+                    float* pRow = Row(channel, y);
+                    pRow[-1] = pRow[0];
+                    pRow[Width] = pRow[Width - 1];
+                }
+                memcpy(Row(channel, -1) - 1, Row(channel, 0) - 1, (Width + 2) * sizeof(float));
+                memcpy(Row(channel, Height) - 1, Row(channel, Height - 1) - 1, (Width + 2) * sizeof(float));
+            }
+        }
+    };
+
+    static PassWeights g_passWeights[NumPasses];
+    static bool g_initialized = false;
+
+    // Luma input, then the outputs of passes 1-4
+    static FeatureMap g_featureMaps[NumPasses + 1];
+
+    // U and V of the input, used for the chroma of the upscaled image
+    static FeatureMap g_chroma;
+
+    // Precalculated lanczos2 taps for one row or column of the downscale output. The source indices are
+    // already clamped to the image.
+    struct DownscaleTaps
+    {
+        int Indices[4];
+        float Weights[4];
+    };
+
+    // One source row filtered horizontally: per color channel the weighted sum of the 4 column taps
+    // and their minimum and maximum, each dstWidth (rounded up to VecWidth) floats long
+    struct DownscaleRow
+    {
+        int SourceRow = -1;
+        vector<float> Values;
+
+        float* Sums(int channel, int width) { return &Values[(size_t)(channel * 3 + 0) * width]; }
+        float* Mins(int channel, int width) { return &Values[(size_t)(channel * 3 + 1) * width]; }
+        float* Maxs(int channel, int width) { return &Values[(size_t)(channel * 3 + 2) * width]; }
+    };
+
+    static vector<DownscaleTaps> g_downscaleColumnTaps;
+    static vector<DownscaleTaps> g_downscaleRowTaps;
+
+    // Threads that ParallelForRows() hands bands of rows to. They're started on first use and then wait for work for
+    // the rest of the game, since creating and joining a thread per band cost about as much as the smaller passes.
+    // The pool is never destroyed: joining threads while the DLL is being unloaded would deadlock on the loader lock.
+    // Only one job runs at a time; all of the job state is protected by Mutex.
+    struct WorkerPool
+    {
+        mutex Mutex;
+        condition_variable WorkAvailable;
+        condition_variable WorkDone;
+        const function<void(int, int)>* pProcessRows = nullptr;
+        int NumRows = 0;
+        int NumBands = 0;
+        int NextBand = 0;
+        int NumBandsLeft = 0;
+
+        explicit WorkerPool(int numWorkers)
+        {
+            for (int i = 0; i < numWorkers; i++)
+            {
+                thread([this]
+                {
+                    unique_lock<mutex> lock(Mutex);
+                    while (true)
+                    {
+                        WorkAvailable.wait(lock, [this] { return NextBand < NumBands; });
+                        RunBands(lock);
+                    }
+                }).detach();
+            }
+        }
+
+        // Processes bands of the current job until none are left to start
+        void RunBands(unique_lock<mutex>& lock)
+        {
+            while (NextBand < NumBands)
+            {
+                const function<void(int, int)>& processRows = *pProcessRows;
+                int band = NextBand++;
+                int rowBegin = NumRows * band / NumBands;
+                int rowEnd = NumRows * (band + 1) / NumBands;
+                lock.unlock();
+                processRows(rowBegin, rowEnd);
+                lock.lock();
+                if (--NumBandsLeft == 0)
+                    WorkDone.notify_one();
+            }
+        }
+
+        void Run(int numRows, int numBands, const function<void(int, int)>& processRows)
+        {
+            unique_lock<mutex> lock(Mutex);
+            pProcessRows = &processRows;
+            NumRows = numRows;
+            NumBands = numBands;
+            NextBand = 0;
+            NumBandsLeft = numBands;
+            WorkAvailable.notify_all();
+
+            RunBands(lock);
+            WorkDone.wait(lock, [this] { return NumBandsLeft == 0; });
+            pProcessRows = nullptr;
+            NumBands = 0;
+            NextBand = 0;
+        }
+    };
+
+    // Splits the rows over all cores and waits for them to be done
+    static void ParallelForRows(int numRows, const function<void(int, int)>& processRows)
+    {
+        static const int numThreads = max(1, (int)thread::hardware_concurrency());
+        int numBands = min(numThreads, numRows);
+        if (numBands <= 1)
+        {
+            processRows(0, numRows);
+            return;
+        }
+
+        static WorkerPool* pWorkerPool = new WorkerPool(numThreads - 1);
+        pWorkerPool->Run(numRows, numBands, processRows);
+    }
+
+    // Steps through a shader statement. Each call skips whitespace and then has to match, otherwise Ok turns false
+    // and the following calls do nothing. Spaces in Text() match any amount of whitespace.
+    struct StatementParser
+    {
+        const char* Pos;
+        bool Ok = true;
+
+        explicit StatementParser(const char* pText)
+            : Pos(pText)
+        {
+        }
+
+        void SkipWhitespace()
+        {
+            while (*Pos == ' ' || *Pos == '\t' || *Pos == '\r' || *Pos == '\n')
+                Pos++;
+        }
+
+        StatementParser& Text(const char* pText)
+        {
+            for (; Ok && *pText != '\0'; pText++)
+            {
+                if (*pText == ' ')
+                {
+                    SkipWhitespace();
+                    continue;
+                }
+
+                SkipWhitespace();
+                if (*Pos != *pText)
+                    Ok = false;
+                else
+                    Pos++;
+            }
+            return *this;
+        }
+
+        StatementParser& Int(int& value)
+        {
+            char* pEnd = nullptr;
+            long result = Ok ? strtol(Pos, &pEnd, 10) : 0;
+            Ok = Ok && pEnd != Pos;
+            if (Ok)
+            {
+                value = (int)result;
+                Pos = pEnd;
+            }
+            return *this;
+        }
+
+        StatementParser& Float(float& value)
+        {
+            char* pEnd = nullptr;
+            float result = Ok ? strtof(Pos, &pEnd) : 0.0f;
+            Ok = Ok && pEnd != Pos;
+            if (Ok)
+            {
+                value = result;
+                Pos = pEnd;
+            }
+            return *this;
+        }
+
+        StatementParser& Floats(float* pValues, int count)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                if (i > 0)
+                    Text(",");
+
+                Float(pValues[i]);
+            }
+            return *this;
+        }
+
+        bool AtEnd()
+        {
+            SkipWhitespace();
+            return Ok && *Pos == '\0';
+        }
+    };
+
+    // Runs through the statements of a pass and adds up the weights they apply. The shaders are generated code that
+    // only uses a handful of statement forms:
+    //   s0_1_2 = L1(1.0, 0.0)                 load the 4 channels of input texture 1 at offset (1, 0) into s0_1_2
+    //   r0 += mul(s0_1_2, M4(...16 floats))   multiply them with a 4x4 matrix and add the result to output channels 0-3
+    //   r0 += V4(...4 floats) * s0_1_2        (pass 1) multiply a single input channel with a weight per output channel
+    //   r0 += V4(...4 floats)                 add biases to output channels 0-3
+    // Anything else (max(), stores, the final pixel shuffle) is implemented directly.
+    static bool ParsePass(const string& body, int pass, PassWeights& weights)
+    {
+        weights.NumInputs = PassInputChannels[pass];
+        weights.NumOutputs = PassOutputChannels[pass];
+        weights.Weights.assign((size_t)weights.NumInputs * NumTaps * weights.NumOutputs, 0.0f);
+        weights.Biases.assign(weights.NumOutputs, 0.0f);
+
+        struct Sample
+        {
+            int Texture = -1;
+            int Tap = 0;
+        };
+        Sample samples[2][3][3];
+
+        int numWeightStatements = 0;
+        size_t pos = 0;
+        while (pos < body.size())
+        {
+            size_t end = body.find(';', pos);
+            if (end == string::npos)
+                break;
+
+            string statement = body.substr(pos, end - pos);
+            pos = end + 1;
+            statement.erase(0, statement.find_first_not_of(" \t\r\n"));
+
+            int slot = 0, row = 0, column = 0, texture = 0, output = 0;
+            float x = 0.0f, y = 0.0f;
+            float m[16];
+            StatementParser parser(statement.c_str());
+            if (parser.Text("s").Int(slot).Text("_").Int(row).Text("_").Int(column).Text("= L").Int(texture)
+                      .Text("(").Float(x).Text(",").Float(y).Text(")").Ok)
+            {
+                if (slot < 0 || slot > 1 || row < 0 || row > 2 || column < 0 || column > 2 || texture < 0 || (texture + 1) * 4 > max(weights.NumInputs, 4))
+                    return false;
+
+                samples[slot][row][column] = { texture, ((int)y + 1) * 3 + ((int)x + 1) };
+                continue;
+            }
+
+            parser = StatementParser(statement.c_str());
+            if (parser.Text("r").Int(output).Text("+= mul(s").Int(slot).Text("_").Int(row).Text("_").Int(column)
+                      .Text(", M4(").Floats(m, 16).Text("))").Ok)
+            {
+                if (output < 0 || (output + 1) * 4 > weights.NumOutputs || slot < 0 || slot > 1 || row < 0 || row > 2 || column < 0 || column > 2)
+                    return false;
+
+                const Sample& sample = samples[slot][row][column];
+                if (sample.Texture < 0 || weights.NumInputs < 4)
+                    return false;
+
+                // mul(vector, matrix) treats the vector as a row: output j gets the sum of input i * m[i][j]
+                for (int i = 0; i < 4; i++)
+                {
+                    for (int j = 0; j < 4; j++)
+                    {
+                        int input = sample.Texture * 4 + i;
+                        weights.Weights[((size_t)input * NumTaps + sample.Tap) * weights.NumOutputs + output * 4 + j] += m[i * 4 + j];
+                    }
+                }
+                numWeightStatements++;
+                continue;
+            }
+
+            parser = StatementParser(statement.c_str());
+            if (!parser.Text("r").Int(output).Text("+= V4(").Floats(m, 4).Text(")").Ok)
+                continue;
+
+            if (output < 0 || (output + 1) * 4 > weights.NumOutputs)
+                return false;
+
+            if (parser.AtEnd())
+            {
+                for (int j = 0; j < 4; j++)
+                {
+                    weights.Biases[output * 4 + j] += m[j];
+                }
+                continue;
+            }
+
+            if (parser.Text("* s").Int(slot).Text("_").Int(row).Text("_").Int(column).Ok)
+            {
+                if (slot < 0 || slot > 1 || row < 0 || row > 2 || column < 0 || column > 2)
+                    return false;
+
+                const Sample& sample = samples[slot][row][column];
+                if (sample.Texture != 0 || weights.NumInputs != 1)
+                    return false;
+
+                for (int j = 0; j < 4; j++)
+                {
+                    weights.Weights[(size_t)sample.Tap * weights.NumOutputs + output * 4 + j] += m[j];
+                }
+                numWeightStatements++;
+            }
+        }
+
+        // Every output vector gets a contribution from every input vector at every tap
+        int numInputVectors = max(weights.NumInputs / 4, 1);
+        return numWeightStatements == numInputVectors * NumTaps * weights.NumOutputs / 4;
+    }
+
+    bool Initialize()
+    {
+        if (g_initialized)
+            return true;
+
+        string shader = g_CuNNyFastNVL;
+        for (int pass = 0; pass < NumPasses; pass++)
+        {
+            string body = CuNNyShaderSource::ExtractPassBody(shader, pass + 1);
+            if (body.empty() || !ParsePass(body, pass, g_passWeights[pass]))
+                return false;
+        }
+
+        g_initialized = true;
+        return true;
+    }
+
+    bool IsAvailable()
+    {
+        return g_initialized;
+    }
+
+    // Adds one input sample times its weight to every output. Spelled out with a fold expression rather than
+    // a loop so the accumulators reliably end up in registers instead of depending on the optimizer to unroll it.
+    template<size_t... Outputs>
+    static void MulAddOutputs(FloatVec* acc, const float* pWeights, FloatVec sample, index_sequence<Outputs...>)
+    {
+        ((acc[Outputs] = VecMulAdd(VecSet(pWeights[Outputs]), sample, acc[Outputs])), ...);
+    }
+
+    // Runs a 3x3 convolution over rows [rowBegin, rowEnd) of the input, optionally followed by a ReLU
+    template<int NumOutputs>
+    static void ConvolveRows(const FeatureMap& input, FeatureMap& output, const PassWeights& weights, bool relu, int rowBegin, int rowEnd)
+    {
+        ptrdiff_t tapOffsets[NumTaps];
+        for (int tap = 0; tap < NumTaps; tap++)
+        {
+            tapOffsets[tap] = (ptrdiff_t)(tap / 3 - 1) * input.Stride + (tap % 3 - 1);
+        }
+
+        for (int y = rowBegin; y < rowEnd; y++)
+        {
+            for (int x = 0; x < input.Width; x += VecWidth)
+            {
+                FloatVec acc[NumOutputs];
+                for (int o = 0; o < NumOutputs; o++)
+                {
+                    acc[o] = VecSet(weights.Biases[o]);
+                }
+
+                for (int i = 0; i < weights.NumInputs; i++)
+                {
+                    const float* pCenter = input.Row(i, y) + x;
+                    const float* pWeights = &weights.Weights[(size_t)i * NumTaps * NumOutputs];
+                    for (int tap = 0; tap < NumTaps; tap++)
+                    {
+                        FloatVec sample = VecLoad(pCenter + tapOffsets[tap]);
+                        MulAddOutputs(acc, pWeights, sample, make_index_sequence<NumOutputs>());
+                        pWeights += NumOutputs;
+                    }
+                }
+
+                for (int o = 0; o < NumOutputs; o++)
+                {
+                    VecStore(output.Row(o, y) + x, relu ? VecMax(acc[o], VecSet(0.0f)) : acc[o]);
+                }
+            }
+        }
+    }
+
+    template<int NumOutputs>
+    static void Convolve(const FeatureMap& input, FeatureMap& output, const PassWeights& weights, bool relu)
+    {
+        ParallelForRows(input.Height, [&](int rowBegin, int rowEnd)
+        {
+            ConvolveRows<NumOutputs>(input, output, weights, relu, rowBegin, rowEnd);
+        });
+        output.FillBorder();
+    }
+
+    static unsigned char ToUnorm8(float value)
+    {
+        return (unsigned char)(clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+
+    // Pass 4's pixel shuffle: each input pixel turns into 2x2 output pixels whose luma is the bilinearly upscaled
+    // input luma plus one of the pixel's 4 residual channels, keeping the upscaled chroma. The output pixel's
+    // center lies a quarter input pixel away from the input pixel's center, so bilinear filtering weighs the input
+    // pixel and its neighbours by 9:3:3:1. That's done on the YUV planes directly, which gives the same result
+    // as converting the filtered RGB since both steps are linear.
+    static void ShuffleRows(const FeatureMap& luma, const FeatureMap& chroma, const FeatureMap& residuals,
+        unsigned char* pDest, int destPitch, int rowBegin, int rowEnd)
+    {
+        static const float YR[3][3] = { { 1.0f, -0.00093f, 1.401687f }, { 1.0f, -0.3437f, -0.71417f }, { 1.0f, 1.77216f, 0.00099f } };
+
+        int width = luma.Width;
+        vector<float> rgb[3];
+        for (vector<float>& channel : rgb)
+        {
+            channel.resize(width + VecWidth);
+        }
+
+        for (int y = rowBegin; y < rowEnd; y++)
+        {
+            for (int dy = 0; dy < 2; dy++)
+            {
+                int nearY = y + dy * 2 - 1;
+                for (int dx = 0; dx < 2; dx++)
+                {
+                    int nearX = dx * 2 - 1;
+                    const float* pResiduals = residuals.Row(dy * 2 + dx, y);
+                    for (int x = 0; x < width; x += VecWidth)
+                    {
+                        FloatVec yuv[3];
+                        for (int i = 0; i < 3; i++)
+                        {
+                            const FeatureMap& plane = i == 0 ? luma : chroma;
+                            int channel = i == 0 ? 0 : i - 1;
+                            const float* pCenterRow = plane.Row(channel, y) + x;
+                            const float* pNearRow = plane.Row(channel, nearY) + x;
+                            FloatVec value = VecMulAdd(VecSet(9.0f / 16), VecLoad(pCenterRow), VecSet(0.0f));
+                            value = VecMulAdd(VecSet(3.0f / 16), VecLoad(pCenterRow + nearX), value);
+                            value = VecMulAdd(VecSet(3.0f / 16), VecLoad(pNearRow), value);
+                            yuv[i] = VecMulAdd(VecSet(1.0f / 16), VecLoad(pNearRow + nearX), value);
+                        }
+                        yuv[0] = VecMin(VecMax(VecMulAdd(VecSet(1.0f), VecLoad(pResiduals + x), yuv[0]), VecSet(0.0f)), VecSet(1.0f));
+
+                        for (int c = 0; c < 3; c++)
+                        {
+                            FloatVec value = VecMulAdd(VecSet(YR[c][1]), yuv[1], yuv[0]);
+                            value = VecMulAdd(VecSet(YR[c][2]), yuv[2], value);
+                            VecStore(&rgb[c][x], value);
+                        }
+                    }
+
+                    unsigned char* pPixel = pDest + (size_t)(y * 2 + dy) * destPitch + dx * 4;
+                    for (int x = 0; x < width; x++)
+                    {
+                        pPixel[0] = ToUnorm8(rgb[2][x]);
+                        pPixel[1] = ToUnorm8(rgb[1][x]);
+                        pPixel[2] = ToUnorm8(rgb[0][x]);
+                        pPixel[3] = 255;
+                        pPixel += 8;
+                    }
+                }
+            }
+        }
+    }
+
+    void Upscale2x(const void* pSource, int sourcePitch, int srcWidth, int srcHeight, void* pDest, int destPitch)
+    {
+        static const float RY[3][3] = { { 0.299f, 0.587f, 0.114f }, { -0.169f, -0.331f, 0.5f }, { 0.5f, -0.419f, -0.081f } };
+
+        if (!g_initialized || srcWidth <= 0 || srcHeight <= 0)
+            return;
+
+        FeatureMap& luma = g_featureMaps[0];
+        if (luma.Width != srcWidth || luma.Height != srcHeight)
+        {
+            luma.Resize(1, srcWidth, srcHeight);
+            g_chroma.Resize(2, srcWidth, srcHeight);
+            for (int pass = 0; pass < NumPasses; pass++)
+            {
+                g_featureMaps[pass + 1].Resize(PassOutputChannels[pass], srcWidth, srcHeight);
+            }
+        }
+
+        const unsigned char* pSourcePixels = (const unsigned char*)pSource;
+        ParallelForRows(srcHeight, [&](int rowBegin, int rowEnd)
+        {
+            for (int y = rowBegin; y < rowEnd; y++)
+            {
+                const unsigned char* pPixel = pSourcePixels + (size_t)y * sourcePitch;
+                float* pPlanes[3] = { luma.Row(0, y), g_chroma.Row(0, y), g_chroma.Row(1, y) };
+                for (int x = 0; x < srcWidth; x++)
+                {
+                    float r = pPixel[2] / 255.0f;
+                    float g = pPixel[1] / 255.0f;
+                    float b = pPixel[0] / 255.0f;
+                    for (int i = 0; i < 3; i++)
+                    {
+                        pPlanes[i][x] = RY[i][0] * r + RY[i][1] * g + RY[i][2] * b;
+                    }
+                    pPixel += 4;
+                }
+            }
+        });
+        luma.FillBorder();
+        g_chroma.FillBorder();
+
+        Convolve<12>(g_featureMaps[0], g_featureMaps[1], g_passWeights[0], true);
+        Convolve<12>(g_featureMaps[1], g_featureMaps[2], g_passWeights[1], true);
+        Convolve<8>(g_featureMaps[2], g_featureMaps[3], g_passWeights[2], true);
+        Convolve<4>(g_featureMaps[3], g_featureMaps[4], g_passWeights[3], false);
+
+        ParallelForRows(srcHeight, [&](int rowBegin, int rowEnd)
+        {
+            ShuffleRows(luma, g_chroma, g_featureMaps[4], (unsigned char*)pDest, destPitch, rowBegin, rowEnd);
+        });
+    }
+
+    static float Lanczos(float x)
+    {
+        // blur = 1
+        const float pi = 3.1415926535897932f;
+        float kx = pi * x;
+        float wx = 0.5f * kx;
+        return x < 1e-5f ? 1.0f : sin(kx) * sin(wx) / (x * x);
+    }
+
+    static void CalculateDownscaleTaps(int srcSize, int dstSize, vector<DownscaleTaps>& taps)
+    {
+        taps.resize(dstSize);
+        for (int i = 0; i < dstSize; i++)
+        {
+            float pos = (i + 0.5f) / dstSize * srcSize - 0.5f;
+            float first = floor(pos);
+            float f = pos - first;
+            float weights[4] = { Lanczos(1 + f), Lanczos(f), Lanczos(1 - f), Lanczos(2 - f) };
+            float sum = weights[0] + weights[1] + weights[2] + weights[3];
+
+            for (int j = 0; j < 4; j++)
+            {
+                taps[i].Indices[j] = clamp((int)first - 1 + j, 0, srcSize - 1);
+                taps[i].Weights[j] = weights[j] / sum;
+            }
+        }
+    }
+
+    // Filters the squared values of a source row horizontally for each output column
+    static void FilterDownscaleRow(const unsigned char* pSourceRow, int dstWidth, int rowWidth, DownscaleRow& row)
+    {
+        static const auto squaredValues = []
+        {
+            array<float, 256> values{};
+            for (int i = 0; i < 256; i++)
+            {
+                values[i] = (i / 255.0f) * (i / 255.0f);
+            }
+            return values;
+        }();
+
+        for (int c = 0; c < 3; c++)
+        {
+            float* pSums = row.Sums(c, rowWidth);
+            float* pMins = row.Mins(c, rowWidth);
+            float* pMaxs = row.Maxs(c, rowWidth);
+            for (int x = 0; x < dstWidth; x++)
+            {
+                const DownscaleTaps& taps = g_downscaleColumnTaps[x];
+                float sum = 0.0f;
+                float minValue = 1e6f;
+                float maxValue = -1e6f;
+                for (int i = 0; i < 4; i++)
+                {
+                    float sample = squaredValues[pSourceRow[taps.Indices[i] * 4 + c]];
+                    minValue = min(minValue, sample);
+                    maxValue = max(maxValue, sample);
+                    sum += taps.Weights[i] * sample;
+                }
+                pSums[x] = sum;
+                pMins[x] = minValue;
+                pMaxs[x] = maxValue;
+            }
+        }
+    }
+
+    void Downscale(const void* pSource, int sourcePitch, int srcWidth, int srcHeight, void* pDest, int destPitch, int dstWidth, int dstHeight)
+    {
+        if (srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0)
+            return;
+
+        CalculateDownscaleTaps(srcWidth, dstWidth, g_downscaleColumnTaps);
+        CalculateDownscaleTaps(srcHeight, dstHeight, g_downscaleRowTaps);
+
+        // Filter horizontally, then vertically. Each band of output rows keeps the last 4 horizontally filtered
+        // source rows around, so those only get calculated again where two bands meet.
+        const unsigned char* pSourcePixels = (const unsigned char*)pSource;
+        int rowWidth = (dstWidth + VecWidth - 1) / VecWidth * VecWidth;
+        ParallelForRows(dstHeight, [&](int rowBegin, int rowEnd)
+        {
+            DownscaleRow rows[4];
+            for (DownscaleRow& row : rows)
+            {
+                row.Values.assign((size_t)rowWidth * 9, 0.0f);
+            }
+            vector<float> values(rowWidth);
+
+            for (int y = rowBegin; y < rowEnd; y++)
+            {
+                const DownscaleTaps& rowTaps = g_downscaleRowTaps[y];
+                DownscaleRow* pRows[4];
+                for (int j = 0; j < 4; j++)
+                {
+                    int sourceRow = rowTaps.Indices[j];
+                    pRows[j] = &rows[sourceRow % 4];
+                    if (pRows[j]->SourceRow != sourceRow)
+                    {
+                        FilterDownscaleRow(pSourcePixels + (size_t)sourceRow * sourcePitch, dstWidth, rowWidth, *pRows[j]);
+                        pRows[j]->SourceRow = sourceRow;
+                    }
+                }
+
+                unsigned char* pDestRow = (unsigned char*)pDest + (size_t)y * destPitch;
+                for (int c = 0; c < 3; c++)
+                {
+                    // Clamp the result to the range of the 16 source pixels so the negative lobes can't cause ringing
+                    for (int x = 0; x < dstWidth; x += VecWidth)
+                    {
+                        FloatVec value = VecSet(0.0f);
+                        FloatVec minValue = VecSet(1e6f);
+                        FloatVec maxValue = VecSet(-1e6f);
+                        for (int j = 0; j < 4; j++)
+                        {
+                            value = VecMulAdd(VecSet(rowTaps.Weights[j]), VecLoad(pRows[j]->Sums(c, rowWidth) + x), value);
+                            minValue = VecMin(minValue, VecLoad(pRows[j]->Mins(c, rowWidth) + x));
+                            maxValue = VecMax(maxValue, VecLoad(pRows[j]->Maxs(c, rowWidth) + x));
+                        }
+                        VecStore(&values[x], VecSqrt(VecMax(VecMin(value, maxValue), minValue)));
+                    }
+
+                    for (int x = 0; x < dstWidth; x++)
+                    {
+                        pDestRow[x * 4 + c] = ToUnorm8(values[x]);
+                    }
+                }
+
+                for (int x = 0; x < dstWidth; x++)
+                {
+                    pDestRow[x * 4 + 3] = 255;
+                }
+            }
+        });
+    }
+
+    // State shared between QueueFrame()/TakeScaledFrame() and the background thread, protected by Mutex.
+    // Like the worker pool, the thread is started on first use and never stopped.
+    struct BackgroundScaler
+    {
+        mutex Mutex;
+        condition_variable FrameQueued;
+
+        vector<unsigned char> QueuedPixels;
+        int QueuedWidth = 0;
+        int QueuedHeight = 0;
+        int QueuedDstWidth = 0;
+        int QueuedDstHeight = 0;
+        int QueuedFrameId = 0;
+        bool HasQueuedFrame = false;
+
+        vector<unsigned char> ScaledPixels;
+        int ScaledWidth = 0;
+        int ScaledHeight = 0;
+        int ScaledFrameId = 0;
+        bool HasScaledFrame = false;
+
+        BackgroundScaler()
+        {
+            thread([this]
+            {
+                vector<unsigned char> source;
+                vector<unsigned char> upscaled;
+                vector<unsigned char> scaled;
+                unique_lock<mutex> lock(Mutex);
+                while (true)
+                {
+                    FrameQueued.wait(lock, [this] { return HasQueuedFrame; });
+                    swap(source, QueuedPixels);
+                    int width = QueuedWidth;
+                    int height = QueuedHeight;
+                    int dstWidth = QueuedDstWidth;
+                    int dstHeight = QueuedDstHeight;
+                    int frameId = QueuedFrameId;
+                    HasQueuedFrame = false;
+                    lock.unlock();
+
+                    upscaled.resize((size_t)width * 2 * height * 2 * 4);
+                    scaled.resize((size_t)dstWidth * dstHeight * 4);
+                    Upscale2x(source.data(), width * 4, width, height, upscaled.data(), width * 2 * 4);
+                    Downscale(upscaled.data(), width * 2 * 4, width * 2, height * 2, scaled.data(), dstWidth * 4, dstWidth, dstHeight);
+
+                    lock.lock();
+                    swap(scaled, ScaledPixels);
+                    ScaledWidth = dstWidth;
+                    ScaledHeight = dstHeight;
+                    ScaledFrameId = frameId;
+                    HasScaledFrame = true;
+                }
+            }).detach();
+        }
+    };
+
+    static BackgroundScaler* GetBackgroundScaler()
+    {
+        static BackgroundScaler* pBackgroundScaler = new BackgroundScaler();
+        return pBackgroundScaler;
+    }
+
+    int QueueFrame(const void* pSource, int sourcePitch, int srcWidth, int srcHeight, int dstWidth, int dstHeight)
+    {
+        BackgroundScaler* pScaler = GetBackgroundScaler();
+        lock_guard<mutex> lock(pScaler->Mutex);
+        pScaler->QueuedPixels.resize((size_t)srcWidth * srcHeight * 4);
+        FrameCopy::CopyRows(pScaler->QueuedPixels.data(), srcWidth * 4, pSource, sourcePitch, srcWidth * 4, srcHeight);
+        pScaler->QueuedWidth = srcWidth;
+        pScaler->QueuedHeight = srcHeight;
+        pScaler->QueuedDstWidth = dstWidth;
+        pScaler->QueuedDstHeight = dstHeight;
+        pScaler->QueuedFrameId++;
+        pScaler->HasQueuedFrame = true;
+        pScaler->FrameQueued.notify_one();
+        return pScaler->QueuedFrameId;
+    }
+
+    bool TakeScaledFrame(vector<unsigned char>& pixels, int& width, int& height, int& frameId)
+    {
+        BackgroundScaler* pScaler = GetBackgroundScaler();
+        lock_guard<mutex> lock(pScaler->Mutex);
+        if (!pScaler->HasScaledFrame)
+            return false;
+
+        swap(pixels, pScaler->ScaledPixels);
+        width = pScaler->ScaledWidth;
+        height = pScaler->ScaledHeight;
+        frameId = pScaler->ScaledFrameId;
+        pScaler->HasScaledFrame = false;
+        return true;
+    }
+}
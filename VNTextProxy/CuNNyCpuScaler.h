@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+
+// CPU implementation of the CuNNy-fast-NVL 2x upscale and the antiring lanczos2 downscale that CuNNyScaler runs
+// on the GPU. Used when the shaders aren't available, and as a reference for checking shader changes.
+// The network weights are read from the same shader source (DX11Shaders.h), so the two can't get out of sync.
+// Doesn't use any Win32 functions so it can be built and checked outside of the game as well.
+namespace CuNNyCpuScaler
+{
+    // Extracts the weights from the embedded shader. Returns false if the shader doesn't have the expected layout.
+    bool Initialize();
+
+    // Check if the weights were loaded
+    bool IsAvailable();
+
+    // Upscales a 32-bit BGRA image by 2x. pDest receives srcWidth*2 x srcHeight*2 BGRA pixels (alpha is set to 255).
+    // Pitches are the distances in bytes between the starts of two consecutive rows.
+    void Upscale2x(
+        const void* pSource, int sourcePitch,
+        int srcWidth, int srcHeight,
+        void* pDest, int destPitch
+    );
+
+    // Scales a 32-bit BGRA image to dstWidth x dstHeight using lanczos2 with antiring (meant for the output of Upscale2x)
+    void Downscale(
+        const void* pSource, int sourcePitch,
+        int srcWidth, int srcHeight,
+        void* pDest, int destPitch,
+        int dstWidth, int dstHeight
+    );
+
+    // Runs Upscale2x and Downscale on a background thread so the render thread doesn't have to wait for them.
+    // The frame is copied, so the source can be released right away. A frame that's still waiting for the thread
+    // gets replaced. Returns a number identifying the frame, which increases with every call.
+    int QueueFrame(
+        const void* pSource, int sourcePitch,
+        int srcWidth, int srcHeight,
+        int dstWidth, int dstHeight
+    );
+
+    // If a queued frame has been scaled since the last call, swaps its pixels (dstWidth * 4 bytes per row) into
+    // pixels and returns true along with its size and the number that QueueFrame returned for it
+    bool TakeScaledFrame(std::vector<unsigned char>& pixels, int& width, int& height, int& frameId);
+}
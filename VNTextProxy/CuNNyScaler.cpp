@@ -1,46 +1,22 @@
 #include "pch.h"
 #include "CuNNyScaler.h"
+#include "CuNNyShaderSource.h"
+#include "ShaderCache.h"
 #include "SharedConstants.h"
 #include "Util/Logger.h"
-#include <d3dcompiler.h>
 #include <sstream>
 
-#include "DX11Shaders.h"
-
-#pragma comment(lib, "d3dcompiler.lib")
-
 #define cunny_log(...) proxy_log(LogCategory::SHADER, __VA_ARGS__)
 
 namespace CuNNyScaler
 {
-    // Common D3D11 header for all passes
-    static const char* g_d3d11Header = R"(
-#define V4 min16float4
-#define M4 min16float4x4
-
-cbuffer Constants : register(b0) {
-    uint2 inputSize;
-    uint2 outputSize;
-    float2 inputPt;
-    float2 outputPt;
-};
-
-SamplerState SP : register(s0);
-SamplerState SL : register(s1);
-
-uint2 GetInputSize() { return inputSize; }
-uint2 GetOutputSize() { return outputSize; }
-float2 GetInputPt() { return inputPt; }
-float2 GetOutputPt() { return outputPt; }
-uint2 Rmp8x8(uint idx) { return uint2(idx % 8, idx / 8); }
-)";
-
     static ID3D11Device* g_pDevice = nullptr;
     static ID3D11ComputeShader* g_pPass1CS = nullptr;
     static ID3D11ComputeShader* g_pPass2CS = nullptr;
     static ID3D11ComputeShader* g_pPass3CS = nullptr;
     static ID3D11ComputeShader* g_pPass4CS = nullptr;
-    static ID3D11ComputeShader* g_pDownscaleCS = nullptr;
+    static ID3D11VertexShader* g_pDownscaleVS = nullptr;
+    static ID3D11PixelShader* g_pDownscalePS = nullptr;
     static ID3D11Buffer* g_pConstantBuffer = nullptr;
     static ID3D11SamplerState* g_pPointSampler = nullptr;
     static ID3D11SamplerState* g_pLinearSampler = nullptr;
@@ -53,86 +29,54 @@ uint2 Rmp8x8(uint idx) { return uint2(idx % 8, idx / 8); }
     static ID3D11ShaderResourceView* g_pOutputSRV = nullptr;
     static ID3D11UnorderedAccessView* g_pOutputUAV = nullptr;
 
-    // Downscale output (final target size)
-    static ID3D11Texture2D* g_pDownscaleOutput = nullptr;
-    static ID3D11ShaderResourceView* g_pDownscaleOutputSRV = nullptr;
-    static ID3D11UnorderedAccessView* g_pDownscaleOutputUAV = nullptr;
-    static UINT g_downscaleWidth = 0, g_downscaleHeight = 0;
-
     static UINT g_currentWidth = 0, g_currentHeight = 0;
     static bool g_initialized = false;
 
+    // Whether the output textures still hold the result of the previous incremental call, i.e. haven't been
+    // overwritten with an unrelated frame (such as a video frame) by the full-frame Upscale2x() since
+    static bool g_incrementalUpscaleValid = false;
+
     struct Constants {
         UINT inputWidth, inputHeight, outputWidth, outputHeight;
         float inputPtX, inputPtY, outputPtX, outputPtY;
+        UINT blockOffsetX, blockOffsetY;    // First pixel handled by the dispatch (input pixels for the CuNNy passes),
+                                            // or the position of the downscale's output rectangle in the render target
+        UINT padding[2];                    // Constant buffer sizes must be a multiple of 16 bytes
     };
 
+    // Every CuNNy pass reads a 3x3 neighbourhood of the previous pass' output (the first one of the source),
+    // so a changed source pixel can affect the upscaled output up to 4 source pixels away
+    static constexpr int CuNNyReceptiveFieldRadius = 4;
 
-    static std::string ExtractPass(const std::string& src, int num) {
-        std::string marker = "//!PASS " + std::to_string(num);
-        cunny_log("ExtractPass %d: Looking for marker '%s'", num, marker.c_str());
-        size_t start = src.find(marker);
-        if (start == std::string::npos) {
-            cunny_log("ExtractPass %d: FAILED - marker not found", num);
-            return "";
-        }
-        std::string nextMarker = "//!PASS " + std::to_string(num + 1);
-        size_t end = src.find(nextMarker);
-        if (end == std::string::npos) end = src.length();
-        std::string result = src.substr(start, end - start);
-        cunny_log("ExtractPass %d: SUCCESS - extracted %zu bytes", num, result.length());
-        return result;
-    }
+    // Above this many dirty rectangles, redoing the whole frame is cheaper than all the per-rectangle dispatches
+    static constexpr int MaxPartialRects = 16;
 
-    static std::string ExtractFunctionBody(const std::string& pass, int num) {
-        std::string funcName = "void Pass" + std::to_string(num);
-        cunny_log("ExtractFunctionBody %d: Looking for '%s'", num, funcName.c_str());
-        size_t funcStart = pass.find(funcName);
-        if (funcStart == std::string::npos) {
-            cunny_log("ExtractFunctionBody %d: FAILED - function not found", num);
-            // Log first 200 chars to help debug
-            cunny_log("ExtractFunctionBody %d: pass starts with: %.200s", num, pass.c_str());
-            return "";
-        }
-        cunny_log("ExtractFunctionBody %d: Found function at offset %zu", num, funcStart);
-
-        // Find opening brace
-        size_t braceStart = pass.find('{', funcStart);
-        if (braceStart == std::string::npos) {
-            cunny_log("ExtractFunctionBody %d: FAILED - no opening brace found", num);
-            return "";
-        }
+    // Grows a rectangle by the given amount on each side, rounds it outward to the given alignment and clips it to the texture
+    static FrameTileDiff::Rect ExpandRect(const FrameTileDiff::Rect& rect, int amount, int alignment, int width, int height) {
+        int left = std::max(rect.X - amount, 0) / alignment * alignment;
+        int top = std::max(rect.Y - amount, 0) / alignment * alignment;
+        int right = std::min((rect.X + rect.Width + amount + alignment - 1) / alignment * alignment, width);
+        int bottom = std::min((rect.Y + rect.Height + amount + alignment - 1) / alignment * alignment, height);
+        return { left, top, right - left, bottom - top };
+    }
 
-        // Find matching closing brace
-        int depth = 1;
-        size_t i = braceStart + 1;
-        while (i < pass.length() && depth > 0) {
-            if (pass[i] == '{') depth++;
-            else if (pass[i] == '}') depth--;
-            i++;
+    static void WriteConstants(ID3D11DeviceContext* ctx, const Constants& constants) {
+        D3D11_MAPPED_SUBRESOURCE m;
+        if (SUCCEEDED(ctx->Map(g_pConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &m))) {
+            memcpy(m.pData, &constants, sizeof(constants));
+            ctx->Unmap(g_pConstantBuffer, 0);
         }
-
-        std::string body = pass.substr(braceStart + 1, i - braceStart - 2);
-        cunny_log("ExtractFunctionBody %d: SUCCESS - extracted %zu bytes", num, body.length());
-        return body;
     }
 
+
     static ID3D11ComputeShader* CompileCS(const std::string& src, const char* name) {
-        cunny_log("CompileCS: Compiling %s (%zu bytes)", name, src.length());
-        ID3DBlob *blob = nullptr, *err = nullptr;
-        HRESULT hr = D3DCompile(src.c_str(), src.length(), name, nullptr, nullptr,
-            "main", "cs_5_0", D3DCOMPILE_OPTIMIZATION_LEVEL3, 0, &blob, &err);
-        if (FAILED(hr)) {
-            cunny_log("CompileCS: FAILED to compile %s (hr=0x%08X)", name, hr);
-            if (err) {
-                cunny_log("CompileCS: Shader error:\n%s", (char*)err->GetBufferPointer());
-                err->Release();
-            }
+        std::vector<BYTE> bytecode = ShaderCache::Compile(src, name, "main", "cs_5_0");
+        if (bytecode.empty()) {
+            cunny_log("CompileCS: FAILED to compile %s", name);
             return nullptr;
         }
         ID3D11ComputeShader* cs = nullptr;
-        HRESULT createHr = g_pDevice->CreateComputeShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, &cs);
-        blob->Release();
+        HRESULT createHr = g_pDevice->CreateComputeShader(bytecode.data(), bytecode.size(), nullptr, &cs);
         if (FAILED(createHr)) {
             cunny_log("CompileCS: FAILED to create shader %s (hr=0x%08X)", name, createHr);
             return nullptr;
@@ -141,158 +85,6 @@ uint2 Rmp8x8(uint idx) { return uint2(idx % 8, idx / 8); }
         return cs;
     }
 
-    static std::string BuildPass1(const std::string& body) {
-        return std::string(g_d3d11Header) + R"(
-Texture2D<float4> INPUT : register(t0);
-RWTexture2D<float4> T0 : register(u0);
-RWTexture2D<float4> T1 : register(u1);
-RWTexture2D<float4> T2 : register(u2);
-
-#define O(t, x, y) t.SampleLevel(SP, pos + float2(x, y) * pt, 0)
-#define L0(x, y) min16float(dot(float3(0.299, 0.587, 0.114), O(INPUT, x, y).rgb))
-
-[numthreads(64, 1, 1)]
-void main(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {
-    uint2 blockStart = gid.xy * 8;
-)" + body + "\n}";
-    }
-
-    static std::string BuildPass2(const std::string& body) {
-        return std::string(g_d3d11Header) + R"(
-Texture2D<float4> T0 : register(t0);
-Texture2D<float4> T1 : register(t1);
-Texture2D<float4> T2 : register(t2);
-RWTexture2D<float4> T3 : register(u0);
-RWTexture2D<float4> T4 : register(u1);
-RWTexture2D<float4> T5 : register(u2);
-
-#define O(t, x, y) t.SampleLevel(SP, pos + float2(x, y) * pt, 0)
-#define L0(x, y) V4(O(T0, x, y))
-#define L1(x, y) V4(O(T1, x, y))
-#define L2(x, y) V4(O(T2, x, y))
-
-[numthreads(64, 1, 1)]
-void main(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {
-    uint2 blockStart = gid.xy * 8;
-)" + body + "\n}";
-    }
-
-    static std::string BuildPass3(const std::string& body) {
-        return std::string(g_d3d11Header) + R"(
-Texture2D<float4> T3 : register(t0);
-Texture2D<float4> T4 : register(t1);
-Texture2D<float4> T5 : register(t2);
-RWTexture2D<float4> T0 : register(u0);
-RWTexture2D<float4> T1 : register(u1);
-
-#define O(t, x, y) t.SampleLevel(SP, pos + float2(x, y) * pt, 0)
-#define L0(x, y) V4(O(T3, x, y))
-#define L1(x, y) V4(O(T4, x, y))
-#define L2(x, y) V4(O(T5, x, y))
-
-[numthreads(64, 1, 1)]
-void main(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {
-    uint2 blockStart = gid.xy * 8;
-)" + body + "\n}";
-    }
-
-    static std::string BuildPass4(const std::string& body) {
-        return std::string(g_d3d11Header) + R"(
-Texture2D<float4> INPUT : register(t0);
-Texture2D<float4> T0 : register(t1);
-Texture2D<float4> T1 : register(t2);
-RWTexture2D<float4> OUTPUT : register(u0);
-
-#define O(t, x, y) t.SampleLevel(SP, pos + float2(x, y) * pt, 0)
-#define L0(x, y) V4(O(T0, x, y))
-#define L1(x, y) V4(O(T1, x, y))
-
-[numthreads(64, 1, 1)]
-void main(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {
-    uint2 blockStart = gid.xy * 16;
-)" + body + "\n}";
-    }
-
-
-    static std::string ExtractDownscaleBody(const std::string& src) {
-        // Find "float4 Pass1(float2 p)" function
-        cunny_log("ExtractDownscaleBody: Looking for 'float4 Pass1'");
-        size_t funcStart = src.find("float4 Pass1");
-        if (funcStart == std::string::npos) {
-            cunny_log("ExtractDownscaleBody: FAILED - function not found");
-            return "";
-        }
-
-        size_t braceStart = src.find('{', funcStart);
-        if (braceStart == std::string::npos) return "";
-
-        int depth = 1;
-        size_t i = braceStart + 1;
-        while (i < src.length() && depth > 0) {
-            if (src[i] == '{') depth++;
-            else if (src[i] == '}') depth--;
-            i++;
-        }
-
-        std::string body = src.substr(braceStart + 1, i - braceStart - 2);
-        cunny_log("ExtractDownscaleBody: SUCCESS - extracted %zu bytes", body.length());
-        return body;
-    }
-
-    static std::string ExtractDownscaleFunctions(const std::string& src) {
-        // Extract lanczos function and macros before Pass1
-        size_t passStart = src.find("float4 Pass1");
-        if (passStart == std::string::npos) return "";
-
-        // Find start after //!OUT OUTPUT line
-        size_t funcStart = src.find("float lanczos");
-        if (funcStart == std::string::npos || funcStart > passStart) return "";
-
-        return src.substr(funcStart, passStart - funcStart);
-    }
-
-    static std::string BuildDownscalePass(const std::string& functions, const std::string& body) {
-        return std::string(g_d3d11Header) + R"(
-Texture2D<float4> INPUT : register(t0);
-RWTexture2D<float4> OUTPUT : register(u0);
-
-SamplerState S : register(s0);  // Point sampler for Gather operations
-
-static const float blur = 1.0;
-
-)" + functions + R"(
-
-[numthreads(8, 8, 1)]
-void main(uint3 dtid : SV_DispatchThreadID) {
-    uint2 outSz = GetOutputSize();
-    if (dtid.x >= outSz.x || dtid.y >= outSz.y) return;
-    float2 p = (dtid.xy + 0.5) / float2(outSz);
-)" + body + R"(
-    OUTPUT[dtid.xy] = result;
-}
-)";
-    }
-
-    static bool CreateDownscaleTexture(UINT w, UINT h) {
-        if (g_pDownscaleOutput) { g_pDownscaleOutput->Release(); g_pDownscaleOutput = nullptr; }
-        if (g_pDownscaleOutputSRV) { g_pDownscaleOutputSRV->Release(); g_pDownscaleOutputSRV = nullptr; }
-        if (g_pDownscaleOutputUAV) { g_pDownscaleOutputUAV->Release(); g_pDownscaleOutputUAV = nullptr; }
-
-        D3D11_TEXTURE2D_DESC td = {};
-        td.Width = w; td.Height = h; td.MipLevels = 1; td.ArraySize = 1;
-        td.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-        td.SampleDesc.Count = 1; td.Usage = D3D11_USAGE_DEFAULT;
-        td.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
-
-        if (FAILED(g_pDevice->CreateTexture2D(&td, nullptr, &g_pDownscaleOutput))) return false;
-        if (FAILED(g_pDevice->CreateShaderResourceView(g_pDownscaleOutput, nullptr, &g_pDownscaleOutputSRV))) return false;
-        if (FAILED(g_pDevice->CreateUnorderedAccessView(g_pDownscaleOutput, nullptr, &g_pDownscaleOutputUAV))) return false;
-
-        g_downscaleWidth = w; g_downscaleHeight = h;
-        cunny_log("CreateDownscaleTexture: Created %dx%d texture", w, h);
-        return true;
-    }
-
     static bool CreateTextures(UINT w, UINT h) {
         for (int i = 0; i < 6; i++) {
             if (g_pT[i]) { g_pT[i]->Release(); g_pT[i] = nullptr; }
@@ -354,27 +146,13 @@ void main(uint3 dtid : SV_DispatchThreadID) {
         }
         cunny_log("Initialize: Samplers created");
 
-        std::string shader = g_CuNNyFastNVL;
-        cunny_log("Initialize: Shader loaded from embedded data, %zu bytes", shader.length());
-
-        // Extract and compile each pass
-        for (int p = 1; p <= 4; p++) {
-            cunny_log("Initialize: Processing pass %d", p);
-            std::string pass = ExtractPass(shader, p);
-            std::string body = ExtractFunctionBody(pass, p);
-            if (body.empty()) {
-                cunny_log("Initialize: FAILED - could not extract body for pass %d", p);
+        // Build and compile each pass (the bytecode comes from the shader cache after the first launch)
+        for (int p = 1; p <= CuNNyShaderSource::NumPasses; p++) {
+            std::string fullShader = CuNNyShaderSource::BuildPass(p);
+            if (fullShader.empty()) {
+                cunny_log("Initialize: FAILED - could not extract pass %d from the embedded shader", p);
                 return false;
             }
-            cunny_log("Initialize: Extracted body for pass %d (%zu bytes)", p, body.length());
-
-            std::string fullShader;
-            switch (p) {
-                case 1: fullShader = BuildPass1(body); break;
-                case 2: fullShader = BuildPass2(body); break;
-                case 3: fullShader = BuildPass3(body); break;
-                case 4: fullShader = BuildPass4(body); break;
-            }
             cunny_log("Initialize: Built full shader for pass %d (%zu bytes)", p, fullShader.length());
 
             ID3D11ComputeShader** ppCS = nullptr;
@@ -392,24 +170,17 @@ void main(uint3 dtid : SV_DispatchThreadID) {
             }
         }
 
-        // Load and compile downscale shader
-        std::string downscaleSrc = g_DownscaleHLSL;
-        {
-            std::string functions = ExtractDownscaleFunctions(downscaleSrc);
-            std::string body = ExtractDownscaleBody(downscaleSrc);
-            if (!body.empty()) {
-                // The original returns float4, we need to capture it
-                // Replace "return" with "float4 result ="
-                size_t returnPos = body.rfind("return");
-                if (returnPos != std::string::npos) {
-                    body.replace(returnPos, 6, "float4 result =");
-                }
-                std::string fullShader = BuildDownscalePass(functions, body);
-                cunny_log("Initialize: Built downscale shader (%zu bytes)", fullShader.length());
-                g_pDownscaleCS = CompileCS(fullShader, "Downscale");
-                if (!g_pDownscaleCS) {
-                    cunny_log("Initialize: WARNING - Downscale shader failed to compile, will use direct copy");
-                }
+        // Build and compile downscale shaders
+        std::string downscaleShader = CuNNyShaderSource::BuildDownscale();
+        if (!downscaleShader.empty()) {
+            cunny_log("Initialize: Built downscale shader (%zu bytes)", downscaleShader.length());
+            std::vector<BYTE> vsBytecode = ShaderCache::Compile(CuNNyShaderSource::BuildDownscaleVertexShader(), "DownscaleVS", "main", "vs_5_0");
+            std::vector<BYTE> psBytecode = ShaderCache::Compile(downscaleShader, "Downscale", "main", "ps_5_0");
+            if (vsBytecode.empty() || psBytecode.empty() ||
+                FAILED(pDevice->CreateVertexShader(vsBytecode.data(), vsBytecode.size(), nullptr, &g_pDownscaleVS)) ||
+                FAILED(pDevice->CreatePixelShader(psBytecode.data(), psBytecode.size(), nullptr, &g_pDownscalePS))) {
+                cunny_log("Initialize: WARNING - Downscale shaders failed to compile");
+                if (g_pDownscaleVS) { g_pDownscaleVS->Release(); g_pDownscaleVS = nullptr; }
             }
         }
 
@@ -423,7 +194,8 @@ void main(uint3 dtid : SV_DispatchThreadID) {
         if (g_pPass2CS) { g_pPass2CS->Release(); g_pPass2CS = nullptr; }
         if (g_pPass3CS) { g_pPass3CS->Release(); g_pPass3CS = nullptr; }
         if (g_pPass4CS) { g_pPass4CS->Release(); g_pPass4CS = nullptr; }
-        if (g_pDownscaleCS) { g_pDownscaleCS->Release(); g_pDownscaleCS = nullptr; }
+        if (g_pDownscaleVS) { g_pDownscaleVS->Release(); g_pDownscaleVS = nullptr; }
+        if (g_pDownscalePS) { g_pDownscalePS->Release(); g_pDownscalePS = nullptr; }
         if (g_pConstantBuffer) { g_pConstantBuffer->Release(); g_pConstantBuffer = nullptr; }
         if (g_pPointSampler) { g_pPointSampler->Release(); g_pPointSampler = nullptr; }
         if (g_pLinearSampler) { g_pLinearSampler->Release(); g_pLinearSampler = nullptr; }
@@ -435,130 +207,178 @@ void main(uint3 dtid : SV_DispatchThreadID) {
         if (g_pOutput) { g_pOutput->Release(); g_pOutput = nullptr; }
         if (g_pOutputSRV) { g_pOutputSRV->Release(); g_pOutputSRV = nullptr; }
         if (g_pOutputUAV) { g_pOutputUAV->Release(); g_pOutputUAV = nullptr; }
-        if (g_pDownscaleOutput) { g_pDownscaleOutput->Release(); g_pDownscaleOutput = nullptr; }
-        if (g_pDownscaleOutputSRV) { g_pDownscaleOutputSRV->Release(); g_pDownscaleOutputSRV = nullptr; }
-        if (g_pDownscaleOutputUAV) { g_pDownscaleOutputUAV->Release(); g_pDownscaleOutputUAV = nullptr; }
         g_currentWidth = 0;
         g_currentHeight = 0;
-        g_downscaleWidth = 0;
-        g_downscaleHeight = 0;
         g_pDevice = nullptr;
         g_initialized = false;
+        g_incrementalUpscaleValid = false;
     }
 
-    ID3D11ShaderResourceView* Upscale2x(ID3D11DeviceContext* ctx,
-        ID3D11ShaderResourceView* srcSRV, UINT w, UINT h)
+    // Runs the four CuNNy passes, each over its own region (in source pixels). Every region has to include the
+    // next pass' region plus a 1 pixel border, so that each pass only reads intermediates written in this call.
+    static void RunUpscalePasses(ID3D11DeviceContext* ctx, ID3D11ShaderResourceView* srcSRV,
+        Constants& c, const FrameTileDiff::Rect (&regions)[4])
     {
-        if (!g_initialized) return nullptr;
-        if (w != g_currentWidth || h != g_currentHeight)
-            if (!CreateTextures(w, h)) return nullptr;
-
-        D3D11_MAPPED_SUBRESOURCE m;
-        if (SUCCEEDED(ctx->Map(g_pConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &m))) {
-            Constants* c = (Constants*)m.pData;
-            c->inputWidth = w; c->inputHeight = h;
-            c->outputWidth = w * 2; c->outputHeight = h * 2;
-            c->inputPtX = 1.0f / w; c->inputPtY = 1.0f / h;
-            c->outputPtX = 0.5f / w; c->outputPtY = 0.5f / h;
-            ctx->Unmap(g_pConstantBuffer, 0);
-        }
-
-        ctx->CSSetConstantBuffers(0, 1, &g_pConstantBuffer);
-        ID3D11SamplerState* samplers[] = { g_pPointSampler, g_pLinearSampler };
-        ctx->CSSetSamplers(0, 2, samplers);
-
         ID3D11UnorderedAccessView* nullUAV[3] = {};
         ID3D11ShaderResourceView* nullSRV[3] = {};
-        UINT dispatchX = (w + 7) / 8, dispatchY = (h + 7) / 8;
 
         // Pass 1: INPUT -> T0, T1, T2
+        c.blockOffsetX = regions[0].X; c.blockOffsetY = regions[0].Y;
+        WriteConstants(ctx, c);
         ctx->CSSetShader(g_pPass1CS, nullptr, 0);
         ctx->CSSetShaderResources(0, 1, &srcSRV);
         ID3D11UnorderedAccessView* uav1[] = { g_pTUAV[0], g_pTUAV[1], g_pTUAV[2] };
         ctx->CSSetUnorderedAccessViews(0, 3, uav1, nullptr);
-        ctx->Dispatch(dispatchX, dispatchY, 1);
+        ctx->Dispatch((regions[0].Width + 7) / 8, (regions[0].Height + 7) / 8, 1);
         ctx->CSSetUnorderedAccessViews(0, 3, nullUAV, nullptr);
         ctx->CSSetShaderResources(0, 1, nullSRV);
 
         // Pass 2: T0, T1, T2 -> T3, T4, T5
+        c.blockOffsetX = regions[1].X; c.blockOffsetY = regions[1].Y;
+        WriteConstants(ctx, c);
         ctx->CSSetShader(g_pPass2CS, nullptr, 0);
         ID3D11ShaderResourceView* srv2[] = { g_pTSRV[0], g_pTSRV[1], g_pTSRV[2] };
         ctx->CSSetShaderResources(0, 3, srv2);
         ID3D11UnorderedAccessView* uav2[] = { g_pTUAV[3], g_pTUAV[4], g_pTUAV[5] };
         ctx->CSSetUnorderedAccessViews(0, 3, uav2, nullptr);
-        ctx->Dispatch(dispatchX, dispatchY, 1);
+        ctx->Dispatch((regions[1].Width + 7) / 8, (regions[1].Height + 7) / 8, 1);
         ctx->CSSetUnorderedAccessViews(0, 3, nullUAV, nullptr);
         ctx->CSSetShaderResources(0, 3, nullSRV);
 
         // Pass 3: T3, T4, T5 -> T0, T1
+        c.blockOffsetX = regions[2].X; c.blockOffsetY = regions[2].Y;
+        WriteConstants(ctx, c);
         ctx->CSSetShader(g_pPass3CS, nullptr, 0);
         ID3D11ShaderResourceView* srv3[] = { g_pTSRV[3], g_pTSRV[4], g_pTSRV[5] };
         ctx->CSSetShaderResources(0, 3, srv3);
         ID3D11UnorderedAccessView* uav3[] = { g_pTUAV[0], g_pTUAV[1] };
         ctx->CSSetUnorderedAccessViews(0, 2, uav3, nullptr);
-        ctx->Dispatch(dispatchX, dispatchY, 1);
+        ctx->Dispatch((regions[2].Width + 7) / 8, (regions[2].Height + 7) / 8, 1);
         ctx->CSSetUnorderedAccessViews(0, 2, nullUAV, nullptr);
         ctx->CSSetShaderResources(0, 3, nullSRV);
 
-        // Pass 4: INPUT, T0, T1 -> OUTPUT
+        // Pass 4: INPUT, T0, T1 -> OUTPUT (one thread group per 8x8 source pixels, i.e. 16x16 output pixels)
+        c.blockOffsetX = regions[3].X; c.blockOffsetY = regions[3].Y;
+        WriteConstants(ctx, c);
         ctx->CSSetShader(g_pPass4CS, nullptr, 0);
         ID3D11ShaderResourceView* srv4[] = { srcSRV, g_pTSRV[0], g_pTSRV[1] };
         ctx->CSSetShaderResources(0, 3, srv4);
         ctx->CSSetUnorderedAccessViews(0, 1, &g_pOutputUAV, nullptr);
-        ctx->Dispatch((w * 2 + 15) / 16, (h * 2 + 15) / 16, 1);
+        ctx->Dispatch((regions[3].Width + 7) / 8, (regions[3].Height + 7) / 8, 1);
         ctx->CSSetUnorderedAccessViews(0, 1, nullUAV, nullptr);
         ctx->CSSetShaderResources(0, 3, nullSRV);
+    }
+
+    static Constants GetUpscaleConstants(UINT w, UINT h) {
+        Constants c = {};
+        c.inputWidth = w; c.inputHeight = h;
+        c.outputWidth = w * 2; c.outputHeight = h * 2;
+        c.inputPtX = 1.0f / w; c.inputPtY = 1.0f / h;
+        c.outputPtX = 0.5f / w; c.outputPtY = 0.5f / h;
+        return c;
+    }
+
+    static void BindConstantsAndSamplers(ID3D11DeviceContext* ctx) {
+        ctx->CSSetConstantBuffers(0, 1, &g_pConstantBuffer);
+        ID3D11SamplerState* samplers[] = { g_pPointSampler, g_pLinearSampler };
+        ctx->CSSetSamplers(0, 2, samplers);
+    }
+
+    static ID3D11ShaderResourceView* UpscaleFullFrame(ID3D11DeviceContext* ctx,
+        ID3D11ShaderResourceView* srcSRV, UINT w, UINT h)
+    {
+        if (!g_initialized) return nullptr;
+        if (w != g_currentWidth || h != g_currentHeight)
+            if (!CreateTextures(w, h)) return nullptr;
+
+        Constants c = GetUpscaleConstants(w, h);
+        BindConstantsAndSamplers(ctx);
+
+        FrameTileDiff::Rect full = { 0, 0, (int)w, (int)h };
+        FrameTileDiff::Rect regions[4] = { full, full, full, full };
+        RunUpscalePasses(ctx, srcSRV, c, regions);
 
         return g_pOutputSRV;
     }
 
-    ID3D11ShaderResourceView* Downscale(ID3D11DeviceContext* ctx,
-        ID3D11ShaderResourceView* srcSRV, UINT srcW, UINT srcH,
-        UINT dstW, UINT dstH)
+    ID3D11ShaderResourceView* Upscale2x(ID3D11DeviceContext* ctx,
+        ID3D11ShaderResourceView* srcSRV, UINT w, UINT h)
     {
-        if (!g_initialized || !g_pDownscaleCS) return nullptr;
+        g_incrementalUpscaleValid = false;
+        return UpscaleFullFrame(ctx, srcSRV, w, h);
+    }
 
-        // Create/resize downscale output texture if needed
-        if (dstW != g_downscaleWidth || dstH != g_downscaleHeight) {
-            if (!CreateDownscaleTexture(dstW, dstH)) return nullptr;
+    ID3D11ShaderResourceView* Upscale2x(ID3D11DeviceContext* ctx,
+        ID3D11ShaderResourceView* srcSRV, UINT w, UINT h,
+        const std::vector<FrameTileDiff::Rect>& dirtyRects)
+    {
+        if (!g_initialized) return nullptr;
+
+        // Freshly created or overwritten textures (and long lists of small changes) get the whole frame
+        if (!g_incrementalUpscaleValid || w != g_currentWidth || h != g_currentHeight || (int)dirtyRects.size() > MaxPartialRects) {
+            ID3D11ShaderResourceView* pOutputSRV = UpscaleFullFrame(ctx, srcSRV, w, h);
+            g_incrementalUpscaleValid = pOutputSRV != nullptr;
+            return pOutputSRV;
         }
+        if (dirtyRects.empty())
+            return g_pOutputSRV;
 
-        // Update constants for downscale pass
-        D3D11_MAPPED_SUBRESOURCE m;
-        if (SUCCEEDED(ctx->Map(g_pConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &m))) {
-            Constants* c = (Constants*)m.pData;
-            c->inputWidth = srcW; c->inputHeight = srcH;
-            c->outputWidth = dstW; c->outputHeight = dstH;
-            c->inputPtX = 1.0f / srcW; c->inputPtY = 1.0f / srcH;
-            c->outputPtX = 1.0f / dstW; c->outputPtY = 1.0f / dstH;
-            ctx->Unmap(g_pConstantBuffer, 0);
+        Constants c = GetUpscaleConstants(w, h);
+        BindConstantsAndSamplers(ctx);
+
+        for (const FrameTileDiff::Rect& rect : dirtyRects) {
+            FrameTileDiff::Rect regions[4];
+            regions[3] = ExpandRect(rect, CuNNyReceptiveFieldRadius, 8, w, h);
+            for (int pass = 2; pass >= 0; pass--)
+                regions[pass] = ExpandRect(regions[pass + 1], 1, 8, w, h);
+
+            RunUpscalePasses(ctx, srcSRV, c, regions);
         }
 
-        ctx->CSSetConstantBuffers(0, 1, &g_pConstantBuffer);
-        ID3D11SamplerState* samplers[] = { g_pPointSampler, g_pLinearSampler };
-        ctx->CSSetSamplers(0, 2, samplers);
+        return g_pOutputSRV;
+    }
 
-        // Run downscale pass
-        ctx->CSSetShader(g_pDownscaleCS, nullptr, 0);
-        ctx->CSSetShaderResources(0, 1, &srcSRV);
-        ctx->CSSetUnorderedAccessViews(0, 1, &g_pDownscaleOutputUAV, nullptr);
-        ctx->Dispatch((dstW + 7) / 8, (dstH + 7) / 8, 1);
+    bool Downscale(ID3D11DeviceContext* ctx,
+        ID3D11ShaderResourceView* srcSRV, UINT srcW, UINT srcH,
+        ID3D11RenderTargetView* pDestRTV, UINT offsetX, UINT offsetY,
+        UINT dstW, UINT dstH)
+    {
+        if (!g_initialized || !g_pDownscalePS) return false;
+
+        Constants c = {};
+        c.inputWidth = srcW; c.inputHeight = srcH;
+        c.outputWidth = dstW; c.outputHeight = dstH;
+        c.inputPtX = 1.0f / srcW; c.inputPtY = 1.0f / srcH;
+        c.outputPtX = 1.0f / dstW; c.outputPtY = 1.0f / dstH;
+        c.blockOffsetX = offsetX; c.blockOffsetY = offsetY;
+        WriteConstants(ctx, c);
+
+        // The viewport limits the triangle to the output rectangle
+        D3D11_VIEWPORT viewport = { (float)offsetX, (float)offsetY, (float)dstW, (float)dstH, 0.0f, 1.0f };
+        ctx->RSSetViewports(1, &viewport);
+        ctx->RSSetState(nullptr);
+        ctx->OMSetRenderTargets(1, &pDestRTV, nullptr);
+        ctx->OMSetBlendState(nullptr, nullptr, 0xFFFFFFFF);
+
+        ctx->IASetInputLayout(nullptr);
+        ctx->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        ctx->VSSetShader(g_pDownscaleVS, nullptr, 0);
+        ctx->PSSetShader(g_pDownscalePS, nullptr, 0);
+        ctx->PSSetConstantBuffers(0, 1, &g_pConstantBuffer);
+        ctx->PSSetShaderResources(0, 1, &srcSRV);
+        ctx->PSSetSamplers(0, 1, &g_pPointSampler);
+        ctx->Draw(3, 0);
 
         // Unbind
-        ID3D11UnorderedAccessView* nullUAV = nullptr;
         ID3D11ShaderResourceView* nullSRV = nullptr;
-        ctx->CSSetUnorderedAccessViews(0, 1, &nullUAV, nullptr);
-        ctx->CSSetShaderResources(0, 1, &nullSRV);
-
-        return g_pDownscaleOutputSRV;
+        ctx->PSSetShaderResources(0, 1, &nullSRV);
+        return true;
     }
 
     ID3D11Texture2D* GetUpscaledTexture() { return g_pOutput; }
     ID3D11ShaderResourceView* GetUpscaledSRV() { return g_pOutputSRV; }
-    ID3D11Texture2D* GetDownscaledTexture() { return g_pDownscaleOutput; }
-    ID3D11ShaderResourceView* GetDownscaledSRV() { return g_pDownscaleOutputSRV; }
     bool IsAvailable() { return g_initialized; }
-    bool IsDownscaleAvailable() { return g_initialized && g_pDownscaleCS != nullptr; }
+    bool IsDownscaleAvailable() { return g_initialized && g_pDownscalePS != nullptr; }
 
     void FatalRenderingError(const char* context)
     {
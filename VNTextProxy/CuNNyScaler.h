@@ -1,6 +1,8 @@
 #pragma once
 
 #include <d3d11.h>
+#include <vector>
+#include "Util/FrameTileDiff.h"
 
 namespace CuNNyScaler
 {
@@ -21,29 +23,38 @@ namespace CuNNyScaler
         UINT srcWidth, UINT srcHeight
     );
 
+    // Same as above, but only recomputes the parts of the previous call's output that depend on dirtyRects
+    // (source pixels). Does the whole frame if the output doesn't hold the previous call's result anymore
+    // (first call, size change, or a full-frame Upscale2x() in between).
+    ID3D11ShaderResourceView* Upscale2x(
+        ID3D11DeviceContext* pContext,
+        ID3D11ShaderResourceView* pSourceSRV,
+        UINT srcWidth, UINT srcHeight,
+        const std::vector<FrameTileDiff::Rect>& dirtyRects
+    );
+
     // Get the intermediate 2x upscaled texture for further processing
     ID3D11Texture2D* GetUpscaledTexture();
     ID3D11ShaderResourceView* GetUpscaledSRV();
 
-    // Downscale using Lanczos2 with antiring (for final scale to target size)
+    // Downscale using Lanczos2 with antiring (for final scale to target size), drawing the result straight into
+    // the render target. Replaces a separate downscale texture plus a copy to the pillarbox position.
     // srcSRV: the 2x upscaled texture from Upscale2x
     // srcW/srcH: source dimensions (2x upscaled size)
-    // dstW/dstH: target output dimensions
-    ID3D11ShaderResourceView* Downscale(
+    // offsetX/offsetY, dstW/dstH: target rectangle in the render target
+    bool Downscale(
         ID3D11DeviceContext* pContext,
         ID3D11ShaderResourceView* pSourceSRV,
         UINT srcWidth, UINT srcHeight,
+        ID3D11RenderTargetView* pDestRTV,
+        UINT offsetX, UINT offsetY,
         UINT dstWidth, UINT dstHeight
     );
 
-    // Get the downscaled output texture
-    ID3D11Texture2D* GetDownscaledTexture();
-    ID3D11ShaderResourceView* GetDownscaledSRV();
-
     // Check if CuNNy is available/initialized
     bool IsAvailable();
 
-    // Check if downscale shader is available
+    // Check if downscale shaders are available
     bool IsDownscaleAvailable();
 
     // Show error and exit if rendering fails
@@ -0,0 +1,226 @@
+// Deliberately doesn't include pch.h (and thus windows.h); see CuNNyShaderSource.h
+#include <string>
+
+#include "CuNNyShaderSource.h"
+#include "DX11Shaders.h"
+
+namespace CuNNyShaderSource
+{
+    // Common D3D11 header for all passes
+    static const char* g_d3d11Header = R"(
+#define V4 min16float4
+#define M4 min16float4x4
+
+cbuffer Constants : register(b0) {
+    uint2 inputSize;
+    uint2 outputSize;
+    float2 inputPt;
+    float2 outputPt;
+    uint2 blockOffset;
+};
+
+SamplerState SP : register(s0);
+SamplerState SL : register(s1);
+
+uint2 GetInputSize() { return inputSize; }
+uint2 GetOutputSize() { return outputSize; }
+float2 GetInputPt() { return inputPt; }
+float2 GetOutputPt() { return outputPt; }
+uint2 GetBlockOffset() { return blockOffset; }
+uint2 Rmp8x8(uint idx) { return uint2(idx % 8, idx / 8); }
+)";
+
+    static std::string ExtractPass(const std::string& src, int num) {
+        std::string marker = "//!PASS " + std::to_string(num);
+        size_t start = src.find(marker);
+        if (start == std::string::npos) return "";
+        std::string nextMarker = "//!PASS " + std::to_string(num + 1);
+        size_t end = src.find(nextMarker);
+        if (end == std::string::npos) end = src.length();
+        return src.substr(start, end - start);
+    }
+
+    static std::string ExtractFunctionBody(const std::string& pass, int num) {
+        std::string funcName = "void Pass" + std::to_string(num);
+        size_t funcStart = pass.find(funcName);
+        if (funcStart == std::string::npos) return "";
+
+        // Find opening brace
+        size_t braceStart = pass.find('{', funcStart);
+        if (braceStart == std::string::npos) return "";
+
+        // Find matching closing brace
+        int depth = 1;
+        size_t i = braceStart + 1;
+        while (i < pass.length() && depth > 0) {
+            if (pass[i] == '{') depth++;
+            else if (pass[i] == '}') depth--;
+            i++;
+        }
+
+        return pass.substr(braceStart + 1, i - braceStart - 2);
+    }
+
+    static std::string BuildPass1(const std::string& body) {
+        return std::string(g_d3d11Header) + R"(
+Texture2D<float4> INPUT : register(t0);
+RWTexture2D<float4> T0 : register(u0);
+RWTexture2D<float4> T1 : register(u1);
+RWTexture2D<float4> T2 : register(u2);
+
+#define O(t, x, y) t.SampleLevel(SP, pos + float2(x, y) * pt, 0)
+#define L0(x, y) min16float(dot(float3(0.299, 0.587, 0.114), O(INPUT, x, y).rgb))
+
+[numthreads(64, 1, 1)]
+void main(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {
+    uint2 blockStart = gid.xy * 8 + GetBlockOffset();
+)" + body + "\n}";
+    }
+
+    static std::string BuildPass2(const std::string& body) {
+        return std::string(g_d3d11Header) + R"(
+Texture2D<float4> T0 : register(t0);
+Texture2D<float4> T1 : register(t1);
+Texture2D<float4> T2 : register(t2);
+RWTexture2D<float4> T3 : register(u0);
+RWTexture2D<float4> T4 : register(u1);
+RWTexture2D<float4> T5 : register(u2);
+
+#define O(t, x, y) t.SampleLevel(SP, pos + float2(x, y) * pt, 0)
+#define L0(x, y) V4(O(T0, x, y))
+#define L1(x, y) V4(O(T1, x, y))
+#define L2(x, y) V4(O(T2, x, y))
+
+[numthreads(64, 1, 1)]
+void main(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {
+    uint2 blockStart = gid.xy * 8 + GetBlockOffset();
+)" + body + "\n}";
+    }
+
+    static std::string BuildPass3(const std::string& body) {
+        return std::string(g_d3d11Header) + R"(
+Texture2D<float4> T3 : register(t0);
+Texture2D<float4> T4 : register(t1);
+Texture2D<float4> T5 : register(t2);
+RWTexture2D<float4> T0 : register(u0);
+RWTexture2D<float4> T1 : register(u1);
+
+#define O(t, x, y) t.SampleLevel(SP, pos + float2(x, y) * pt, 0)
+#define L0(x, y) V4(O(T3, x, y))
+#define L1(x, y) V4(O(T4, x, y))
+#define L2(x, y) V4(O(T5, x, y))
+
+[numthreads(64, 1, 1)]
+void main(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {
+    uint2 blockStart = gid.xy * 8 + GetBlockOffset();
+)" + body + "\n}";
+    }
+
+    static std::string BuildPass4(const std::string& body) {
+        return std::string(g_d3d11Header) + R"(
+Texture2D<float4> INPUT : register(t0);
+Texture2D<float4> T0 : register(t1);
+Texture2D<float4> T1 : register(t2);
+RWTexture2D<float4> OUTPUT : register(u0);
+
+#define O(t, x, y) t.SampleLevel(SP, pos + float2(x, y) * pt, 0)
+#define L0(x, y) V4(O(T0, x, y))
+#define L1(x, y) V4(O(T1, x, y))
+
+[numthreads(64, 1, 1)]
+void main(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {
+    uint2 blockStart = gid.xy * 16 + GetBlockOffset() * 2;
+)" + body + "\n}";
+    }
+
+    static std::string ExtractDownscaleBody(const std::string& src) {
+        // Find "float4 Pass1(float2 p)" function
+        size_t funcStart = src.find("float4 Pass1");
+        if (funcStart == std::string::npos) return "";
+
+        size_t braceStart = src.find('{', funcStart);
+        if (braceStart == std::string::npos) return "";
+
+        int depth = 1;
+        size_t i = braceStart + 1;
+        while (i < src.length() && depth > 0) {
+            if (src[i] == '{') depth++;
+            else if (src[i] == '}') depth--;
+            i++;
+        }
+
+        return src.substr(braceStart + 1, i - braceStart - 2);
+    }
+
+    static std::string ExtractDownscaleFunctions(const std::string& src) {
+        // Extract lanczos function and macros before Pass1
+        size_t passStart = src.find("float4 Pass1");
+        if (passStart == std::string::npos) return "";
+
+        // Find start after //!OUT OUTPUT line
+        size_t funcStart = src.find("float lanczos");
+        if (funcStart == std::string::npos || funcStart > passStart) return "";
+
+        return src.substr(funcStart, passStart - funcStart);
+    }
+
+    // Covers the viewport with a single triangle, so no vertex buffer or input layout is needed
+    static const char* g_fullscreenVertexShader = R"(
+float4 main(uint id : SV_VertexID) : SV_Position {
+    float2 uv = float2((id << 1) & 2, id & 2);
+    return float4(uv * float2(2, -2) + float2(-1, 1), 0, 1);
+}
+)";
+
+    static std::string BuildDownscalePass(const std::string& functions, const std::string& body) {
+        return std::string(g_d3d11Header) + R"(
+Texture2D<float4> INPUT : register(t0);
+
+SamplerState S : register(s0);  // Point sampler for Gather operations
+
+static const float blur = 1.0;
+
+)" + functions + R"(
+
+// Drawn with the viewport set to the output rectangle, which starts at GetBlockOffset() in the render target
+float4 main(float4 pos : SV_Position) : SV_Target {
+    float2 p = (pos.xy - GetBlockOffset()) / float2(GetOutputSize());
+)" + body + R"(
+}
+)";
+    }
+
+    std::string ExtractPassBody(const std::string& shader, int pass) {
+        std::string source = ExtractPass(shader, pass);
+        return source.empty() ? "" : ExtractFunctionBody(source, pass);
+    }
+
+    std::string BuildPass(int pass) {
+        std::string body = ExtractPassBody(g_CuNNyFastNVL, pass);
+        if (body.empty())
+            return "";
+
+        switch (pass) {
+            case 1: return BuildPass1(body);
+            case 2: return BuildPass2(body);
+            case 3: return BuildPass3(body);
+            case 4: return BuildPass4(body);
+            default: return "";
+        }
+    }
+
+    std::string BuildDownscale() {
+        std::string downscaleSrc = g_DownscaleHLSL;
+        std::string functions = ExtractDownscaleFunctions(downscaleSrc);
+        std::string body = ExtractDownscaleBody(downscaleSrc);
+        if (body.empty())
+            return "";
+
+        // The original is a pixel shader pass already, so its body can return the output color as is
+        return BuildDownscalePass(functions, body);
+    }
+
+    std::string BuildDownscaleVertexShader() {
+        return g_fullscreenVertexShader;
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+// Assembles the D3D11 shaders for CuNNyScaler from the mpv/magpie style shader sources in DX11Shaders.h:
+// finds the pass functions by their //!PASS markers and wraps them in the resource declarations and entry points
+// of our passes. Doesn't use any Win32 functions so it can be built and checked outside of the game as well.
+namespace CuNNyShaderSource
+{
+    static constexpr int NumPasses = 4;
+
+    // Returns the statements inside the PassN function (N = 1-4) of an mpv style CuNNy shader,
+    // or an empty string if it can't be found
+    std::string ExtractPassBody(const std::string& shader, int pass);
+
+    // Returns the complete compute shader for CuNNy pass 1-4, or an empty string if the embedded source
+    // doesn't have the expected layout
+    std::string BuildPass(int pass);
+
+    // Returns the pixel shader for the antiring lanczos2 downscale, or an empty string if the embedded source
+    // doesn't have the expected layout. It's drawn straight into the output rectangle of a render target.
+    std::string BuildDownscale();
+
+    // Returns the vertex shader to draw the downscale with (a single triangle covering the viewport)
+    std::string BuildDownscaleVertexShader();
+}
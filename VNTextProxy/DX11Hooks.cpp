@@ -9,7 +9,10 @@
 #include "PillarboxedState.h"
 #include "BicubicScaler.h"
 #include "CuNNyScaler.h"
+#include "CuNNyCpuScaler.h"
 #include "PALHooks.h"
+#include "Util/FrameCopy.h"
+#include "Util/FrameTileDiff.h"
 #include "Util/Logger.h"
 
 #pragma comment(lib, "d3d9.lib")
@@ -68,7 +71,7 @@ namespace DX11Hooks
     static ID3D11DeviceContext* g_pD3D11Context = nullptr;
     static IDXGISwapChain1* g_pDXGISwapChain = nullptr;
     static ID3D11Texture2D* g_pD3D11BackBuffer = nullptr;
-    static ID3D11Texture2D* g_pD3D11StagingTexture = nullptr;   // CPU-writable staging texture
+    static ID3D11Texture2D* g_pD3D11StagingTextures[RuntimeConfig::MaxFrameQueueDepth] = {};   // CPU-writable staging textures, one per queued frame
     static ID3D11Texture2D* g_pD3D11SourceTexture = nullptr;   // GPU texture for shader input
     static ID3D11ShaderResourceView* g_pD3D11SourceSRV = nullptr;
     static ID3D11RenderTargetView* g_pD3D11RTV = nullptr;
@@ -79,8 +82,31 @@ namespace DX11Hooks
     static UINT g_dx11GameWidth = 0;  // Staging texture/game width
     static UINT g_dx11GameHeight = 0; // Staging texture/game height
 
-    // Offscreen surface for copying render target data (D3D9)
-    static IDirect3DSurface9* g_pD3D9CopySurface = nullptr;
+    // System memory copies of the game's render target (D3D9), one per queued frame. Every frame is copied into the
+    // next one with GetRenderTargetData(), followed by an event query that tells when the copy is done; only copies
+    // whose query has completed get locked, so the lock doesn't wait for the GPU. With a queue depth of 1 there's no
+    // query, and the copy is locked right away.
+    static IDirect3DSurface9* g_pD3D9CopySurfaces[RuntimeConfig::MaxFrameQueueDepth] = {};
+    static IDirect3DQuery9* g_pD3D9CopyQueries[RuntimeConfig::MaxFrameQueueDepth] = {};
+    static int g_nextCopySlot = 0;
+    static int g_numQueuedFrames = 0;               // Copies that haven't been uploaded (or skipped) yet
+
+    // Tiles of the game frame that changed since the previous upload. Visual novel frames are mostly static,
+    // so usually only a few tiles (or none at all) need to be uploaded and run through the scalers again.
+    static FrameTileDiff g_frameTileDiff;
+
+    // CPU fallback for the CuNNy upscale and lanczos downscale, used when the compute shaders can't be created.
+    // Changed frames are scaled on a background thread, and the last one it finished is presented. Until the
+    // first one is done, the game frame is shown with the bicubic scaler instead.
+    static bool g_cpuScalerActive = false;
+    static bool g_cpuScaledFrameValid = false;
+    static bool g_cpuScaledFrameQueued = false;
+    static int g_cpuScaledFirstFrameId = 0;         // Results of frames queued before this one are out of date
+    static std::vector<BYTE> g_cpuScaledPixels;
+    static ID3D11Texture2D* g_pCpuScaledTexture = nullptr;
+    static ID3D11ShaderResourceView* g_pCpuScaledSRV = nullptr;
+    static UINT g_cpuScaledWidth = 0;
+    static UINT g_cpuScaledHeight = 0;
 
     static void LogSurfaceInfo(const char* label, IDirect3DSurface9* pSurface)
     {
@@ -120,18 +146,148 @@ namespace DX11Hooks
             pp->hDeviceWindow, pp->EnableAutoDepthStencil);
     }
 
+    static void ReleaseD3D9CopySurfaces()
+    {
+        for (IDirect3DSurface9*& pSurface : g_pD3D9CopySurfaces)
+        {
+            if (pSurface)
+            {
+                pSurface->Release();
+                pSurface = nullptr;
+            }
+        }
+        for (IDirect3DQuery9*& pQuery : g_pD3D9CopyQueries)
+        {
+            if (pQuery)
+            {
+                pQuery->Release();
+                pQuery = nullptr;
+            }
+        }
+        g_nextCopySlot = 0;
+        g_numQueuedFrames = 0;
+    }
+
+    static HRESULT CreateD3D9CopySurfaces(IDirect3DDevice9* pDevice, UINT width, UINT height)
+    {
+        ReleaseD3D9CopySurfaces();
+        int queueDepth = RuntimeConfig::FrameQueueDepth();
+        for (int i = 0; i < queueDepth; i++)
+        {
+            HRESULT hr = pDevice->CreateOffscreenPlainSurface(
+                width, height,
+                D3DFMT_X8R8G8B8,
+                D3DPOOL_SYSTEMMEM,
+                &g_pD3D9CopySurfaces[i],
+                nullptr
+            );
+            if (FAILED(hr))
+            {
+                ReleaseD3D9CopySurfaces();
+                return hr;
+            }
+
+            // Without event queries every copy is treated as done, which makes the lock wait for it like at depth 1
+            if (queueDepth > 1)
+            {
+                hr = pDevice->CreateQuery(D3DQUERYTYPE_EVENT, &g_pD3D9CopyQueries[i]);
+                if (FAILED(hr))
+                {
+                    dbg_log("  Failed to create D3D9 event query, hr=0x%x", hr);
+                    g_pD3D9CopyQueries[i] = nullptr;
+                }
+            }
+        }
+        return S_OK;
+    }
+
+    static void ReleaseCpuScaledTexture()
+    {
+        if (g_pCpuScaledSRV) { g_pCpuScaledSRV->Release(); g_pCpuScaledSRV = nullptr; }
+        if (g_pCpuScaledTexture) { g_pCpuScaledTexture->Release(); g_pCpuScaledTexture = nullptr; }
+        g_cpuScaledWidth = 0;
+        g_cpuScaledHeight = 0;
+        g_cpuScaledFrameValid = false;
+        g_cpuScaledFrameQueued = false;
+    }
+
+    // Queues the locked game frame for the CPU scalers if it changed (or the output size did), and uploads the
+    // scaled frame if one has finished since the last call. pLocked is null if no new frame was read back.
+    static bool UpdateCpuScaledFrame(const D3DLOCKED_RECT* pLocked, UINT srcWidth, UINT srcHeight, bool frameChanged)
+    {
+        UINT scaledWidth = PillarboxedState::g_scaledWidth;
+        UINT scaledHeight = PillarboxedState::g_scaledHeight;
+        if (g_cpuScaledWidth != scaledWidth || g_cpuScaledHeight != scaledHeight)
+        {
+            ReleaseCpuScaledTexture();
+
+            D3D11_TEXTURE2D_DESC desc = {};
+            desc.Width = scaledWidth;
+            desc.Height = scaledHeight;
+            desc.MipLevels = 1;
+            desc.ArraySize = 1;
+            desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+            desc.SampleDesc.Count = 1;
+            desc.Usage = D3D11_USAGE_DEFAULT;
+            desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+            HRESULT hr = g_pD3D11Device->CreateTexture2D(&desc, nullptr, &g_pCpuScaledTexture);
+            if (FAILED(hr))
+            {
+                dbg_log("[DX11] Failed to create CPU scaled texture, hr=0x%x", hr);
+                return false;
+            }
+
+            g_pCpuScaledSRV = BicubicScaler::CreateSRV(g_pD3D11Device, g_pCpuScaledTexture);
+            if (!g_pCpuScaledSRV)
+            {
+                dbg_log("[DX11] Failed to create CPU scaled SRV");
+                ReleaseCpuScaledTexture();
+                return false;
+            }
+
+            g_cpuScaledWidth = scaledWidth;
+            g_cpuScaledHeight = scaledHeight;
+        }
+
+        if (pLocked && (frameChanged || !g_cpuScaledFrameQueued))
+        {
+            int frameId = CuNNyCpuScaler::QueueFrame(pLocked->pBits, pLocked->Pitch, srcWidth, srcHeight, scaledWidth, scaledHeight);
+            if (!g_cpuScaledFrameQueued)
+                g_cpuScaledFirstFrameId = frameId;
+
+            g_cpuScaledFrameQueued = true;
+        }
+
+        int width;
+        int height;
+        int frameId;
+        if (CuNNyCpuScaler::TakeScaledFrame(g_cpuScaledPixels, width, height, frameId) &&
+            frameId >= g_cpuScaledFirstFrameId && (UINT)width == scaledWidth && (UINT)height == scaledHeight)
+        {
+            g_pD3D11Context->UpdateSubresource(g_pCpuScaledTexture, 0, nullptr, g_cpuScaledPixels.data(), scaledWidth * 4, 0);
+            g_cpuScaledFrameValid = true;
+        }
+        return true;
+    }
+
     static void CleanupDX11()
     {
         dbg_log("[DX11] Cleaning up DX11 resources...");
         dbg_log("[DX11]   Swapchain=%p, Device=%p, Context=%p", g_pDXGISwapChain, g_pD3D11Device, g_pD3D11Context);
         BicubicScaler::Cleanup();
         CuNNyScaler::Cleanup();
+        ReleaseCpuScaledTexture();
+        g_cpuScalerActive = false;
         g_dx11ScalerInitialized = false;
         if (g_pD3D11SourceSRV) { g_pD3D11SourceSRV->Release(); g_pD3D11SourceSRV = nullptr; }
         if (g_pD3D11SourceTexture) { g_pD3D11SourceTexture->Release(); g_pD3D11SourceTexture = nullptr; }
         if (g_pD3D11RTV) { g_pD3D11RTV->Release(); g_pD3D11RTV = nullptr; }
         if (g_pD3D11BackBuffer) { g_pD3D11BackBuffer->Release(); g_pD3D11BackBuffer = nullptr; }
-        if (g_pD3D11StagingTexture) { g_pD3D11StagingTexture->Release(); g_pD3D11StagingTexture = nullptr; }
+        for (ID3D11Texture2D*& pStagingTexture : g_pD3D11StagingTextures)
+        {
+            if (pStagingTexture) { pStagingTexture->Release(); pStagingTexture = nullptr; }
+        }
         if (g_pDXGISwapChain) {
             dbg_log("[DX11]   Releasing swapchain...");
             ULONG refCount = g_pDXGISwapChain->Release();
@@ -284,7 +440,7 @@ namespace DX11Hooks
             return false;
         }
 
-        // Create staging texture at GAME resolution for CPU copy from D3D9
+        // Create staging textures at GAME resolution for CPU copy from D3D9
         D3D11_TEXTURE2D_DESC stagingDesc = {};
         stagingDesc.Width = gameWidth;
         stagingDesc.Height = gameHeight;
@@ -296,14 +452,17 @@ namespace DX11Hooks
         stagingDesc.BindFlags = 0;
         stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 
-        hr = g_pD3D11Device->CreateTexture2D(&stagingDesc, nullptr, &g_pD3D11StagingTexture);
-        if (FAILED(hr))
+        for (int i = 0; i < RuntimeConfig::FrameQueueDepth(); i++)
         {
-            dbg_log("[DX11] Failed to create staging texture, hr=0x%x", hr);
-            CleanupDX11();
-            return false;
+            hr = g_pD3D11Device->CreateTexture2D(&stagingDesc, nullptr, &g_pD3D11StagingTextures[i]);
+            if (FAILED(hr))
+            {
+                dbg_log("[DX11] Failed to create staging texture, hr=0x%x", hr);
+                CleanupDX11();
+                return false;
+            }
         }
-        dbg_log("[DX11] Created staging texture %dx%d", gameWidth, gameHeight);
+        dbg_log("[DX11] Created %d staging textures %dx%d", RuntimeConfig::FrameQueueDepth(), gameWidth, gameHeight);
 
         // Create source texture for shader input (GPU-side, can be bound as SRV)
         D3D11_TEXTURE2D_DESC sourceDesc = {};
@@ -344,12 +503,21 @@ namespace DX11Hooks
         g_dx11ScalerInitialized = true;
         dbg_log("[DX11] Bicubic scaler initialized");
 
-        // Initialize CuNNy neural network scaler
-        if (!CuNNyScaler::Initialize(g_pD3D11Device))
+        // Initialize CuNNy neural network scaler, falling back to the (much slower) CPU implementation
+        // if the compute shaders can't be created
+        if (CuNNyScaler::Initialize(g_pD3D11Device) && CuNNyScaler::IsDownscaleAvailable())
+        {
+            dbg_log("[DX11] CuNNy neural network scaler initialized");
+        }
+        else
         {
-            CuNNyScaler::FatalRenderingError("CuNNy initialization");
+            CuNNyScaler::Cleanup();
+            if (!CuNNyCpuScaler::Initialize())
+                CuNNyScaler::FatalRenderingError("CuNNy initialization");
+
+            g_cpuScalerActive = true;
+            dbg_log("[DX11] CuNNy compute shaders unavailable, using CPU scaler");
         }
-        dbg_log("[DX11] CuNNy neural network scaler initialized");
 
         // Initialize DirectShow video capture for DX11 rendering
         DirectShowVideoScale::InitializeDX11(g_pD3D11Device, g_pD3D11Context);
@@ -359,6 +527,7 @@ namespace DX11Hooks
         g_dx11Height = screenHeight;
         g_dx11GameWidth = gameWidth;
         g_dx11GameHeight = gameHeight;
+        g_frameTileDiff.Reset(gameWidth, gameHeight);
         g_dx11Active = true;
         dbg_log("[DX11] Initialization complete");
         return true;
@@ -393,27 +562,16 @@ namespace DX11Hooks
             UINT width = pPresentationParameters ? pPresentationParameters->BackBufferWidth : 800;
             UINT height = pPresentationParameters ? pPresentationParameters->BackBufferHeight : 600;
 
-            // Create D3D9 offscreen surface for copying render target
+            // Create D3D9 offscreen surfaces for copying render target
             IDirect3DDevice9* pDevice = *ppReturnedDeviceInterface;
-            if (g_pD3D9CopySurface)
-            {
-                g_pD3D9CopySurface->Release();
-                g_pD3D9CopySurface = nullptr;
-            }
-            HRESULT hrCopy = pDevice->CreateOffscreenPlainSurface(
-                width, height,
-                D3DFMT_X8R8G8B8,
-                D3DPOOL_SYSTEMMEM,
-                &g_pD3D9CopySurface,
-                nullptr
-            );
+            HRESULT hrCopy = CreateD3D9CopySurfaces(pDevice, width, height);
             if (SUCCEEDED(hrCopy))
             {
-                dbg_log("  Created D3D9 copy surface %dx%d", width, height);
+                dbg_log("  Created %d D3D9 copy surfaces %dx%d", RuntimeConfig::FrameQueueDepth(), width, height);
             }
             else
             {
-                dbg_log("  Failed to create D3D9 copy surface, hr=0x%x", hrCopy);
+                dbg_log("  Failed to create D3D9 copy surfaces, hr=0x%x", hrCopy);
             }
 
             if (hWnd && InitializeDX11(hWnd, width, height))
@@ -529,12 +687,8 @@ namespace DX11Hooks
         }
         g_testRenderTargetActive = false;
 
-        // Release D3D9 copy surface before Reset
-        if (g_pD3D9CopySurface)
-        {
-            g_pD3D9CopySurface->Release();
-            g_pD3D9CopySurface = nullptr;
-        }
+        // Release D3D9 copy surfaces before Reset
+        ReleaseD3D9CopySurfaces();
 
         // Always cleanup DX11 before Reset (will recreate after)
         CleanupDX11();
@@ -790,21 +944,15 @@ namespace DX11Hooks
                 dbg_log("  [Reset] Windowed mode: game=%dx%d, DX11=%dx%d", gameWidth, gameHeight, screenWidth, screenHeight);
             }
 
-            // Recreate D3D9 copy surface at GAME resolution
-            HRESULT hrCopy = pThis->CreateOffscreenPlainSurface(
-                gameWidth, gameHeight,
-                D3DFMT_X8R8G8B8,
-                D3DPOOL_SYSTEMMEM,
-                &g_pD3D9CopySurface,
-                nullptr
-            );
+            // Recreate D3D9 copy surfaces at GAME resolution
+            HRESULT hrCopy = CreateD3D9CopySurfaces(pThis, gameWidth, gameHeight);
             if (SUCCEEDED(hrCopy))
             {
-                dbg_log("  [Reset] Recreated D3D9 copy surface %dx%d", gameWidth, gameHeight);
+                dbg_log("  [Reset] Recreated %d D3D9 copy surfaces %dx%d", RuntimeConfig::FrameQueueDepth(), gameWidth, gameHeight);
             }
             else
             {
-                dbg_log("  [Reset] Failed to create D3D9 copy surface, hr=0x%x", hrCopy);
+                dbg_log("  [Reset] Failed to create D3D9 copy surfaces, hr=0x%x", hrCopy);
             }
 
             // Reinitialize DX11
@@ -838,7 +986,7 @@ namespace DX11Hooks
         // DX11 hybrid path - use in both windowed and pillarboxed modes
         // D3D9 renders to offscreen RT, we copy to DX11 and present via DX11 only
         if (g_dx11Active && g_testRenderTargetActive && g_pTestRenderTarget &&
-            g_pDXGISwapChain && g_pD3D11Context && g_pD3D9CopySurface && g_pD3D11StagingTexture)
+            g_pDXGISwapChain && g_pD3D11Context && g_pD3D9CopySurfaces[0] && g_pD3D11StagingTextures[0])
         {
             UINT srcWidth = g_dx11GameWidth;
             UINT srcHeight = g_dx11GameHeight;
@@ -850,8 +998,12 @@ namespace DX11Hooks
                     srcWidth, srcHeight, g_dx11Width, g_dx11Height);
             }
 
-            // 1. Copy D3D9 render target to system memory surface
-            HRESULT hr = pThis->GetRenderTargetData(g_pTestRenderTarget, g_pD3D9CopySurface);
+            // 1. Queue a copy of the D3D9 render target into the next system memory surface of the ring, followed
+            //    by an event query that completes once the copy has been done. The copy is only queued here, and
+            //    doesn't get locked before its query says it's done (see step 2).
+            int queueDepth = RuntimeConfig::FrameQueueDepth();
+            int writeSlot = g_nextCopySlot;
+            HRESULT hr = pThis->GetRenderTargetData(g_pTestRenderTarget, g_pD3D9CopySurfaces[writeSlot]);
             if (FAILED(hr))
             {
                 dbg_log("  [DX11] GetRenderTargetData failed, hr=0x%x", hr);
@@ -860,56 +1012,142 @@ namespace DX11Hooks
                 oSetRenderTarget(pThis, 0, g_pTestRenderTarget);
                 return S_OK;
             }
-
-            // 2. Lock D3D9 surface and copy to DX11 staging texture
-            D3DLOCKED_RECT d3d9Locked;
-            hr = g_pD3D9CopySurface->LockRect(&d3d9Locked, nullptr, D3DLOCK_READONLY);
-            if (FAILED(hr))
+            if (g_pD3D9CopyQueries[writeSlot])
+                g_pD3D9CopyQueries[writeSlot]->Issue(D3DISSUE_END);
+
+            g_nextCopySlot = (writeSlot + 1) % queueDepth;
+            if (g_numQueuedFrames < queueDepth)
+                g_numQueuedFrames++;
+
+            // 2. Pick the newest queued copy that's done (D3DGETDATA_FLUSH submits the queued commands, but doesn't
+            //    wait for them), and drop the older ones. If none is done, the previous upload is presented again,
+            //    unless the ring is full: then the oldest copy is read anyway, as the next frame is copied into it.
+            //    With a queue depth of 1 the copy that was just queued is read right away.
+            int readSlot = -1;
+            for (int age = 0; age < g_numQueuedFrames; age++)
             {
-                dbg_log("  [DX11] LockRect failed, hr=0x%x", hr);
-                oSetRenderTarget(pThis, 0, g_pTestRenderTarget);
-                return S_OK;
+                int slot = (writeSlot - age + queueDepth) % queueDepth;
+                IDirect3DQuery9* pQuery = g_pD3D9CopyQueries[slot];
+                if (queueDepth == 1 || !pQuery || pQuery->GetData(nullptr, 0, D3DGETDATA_FLUSH) == S_OK ||
+                    age == queueDepth - 1)
+                {
+                    readSlot = slot;
+                    g_numQueuedFrames = age;
+                    break;
+                }
             }
 
-            D3D11_MAPPED_SUBRESOURCE d3d11Mapped;
-            HRESULT hrMap = g_pD3D11Context->Map(g_pD3D11StagingTexture, 0, D3D11_MAP_WRITE, 0, &d3d11Mapped);
-            if (FAILED(hrMap))
+            // Lock the copy and find the tiles that changed since the previous upload
+            static const std::vector<FrameTileDiff::Rect> noDirtyRects;
+            IDirect3DSurface9* pCopySurface = nullptr;
+            D3DLOCKED_RECT d3d9Locked = {};
+            int numDirtyTiles = 0;
+            const std::vector<FrameTileDiff::Rect>* pDirtyRects = &noDirtyRects;
+            if (readSlot >= 0)
             {
-                g_pD3D9CopySurface->UnlockRect();
-                dbg_log("  [DX11] Map staging texture failed, hr=0x%x", hrMap);
-                oSetRenderTarget(pThis, 0, g_pTestRenderTarget);
-                return S_OK;
+                pCopySurface = g_pD3D9CopySurfaces[readSlot];
+                hr = pCopySurface->LockRect(&d3d9Locked, nullptr, D3DLOCK_READONLY);
+                if (FAILED(hr))
+                {
+                    dbg_log("  [DX11] LockRect failed, hr=0x%x", hr);
+                    oSetRenderTarget(pThis, 0, g_pTestRenderTarget);
+                    return S_OK;
+                }
+
+                numDirtyTiles = g_frameTileDiff.Update(d3d9Locked.pBits, d3d9Locked.Pitch);
+                pDirtyRects = &g_frameTileDiff.GetDirtyRects();
+            }
+            const std::vector<FrameTileDiff::Rect>& dirtyRects = *pDirtyRects;
+            if (RuntimeConfig::DebugLogging() && presentLogCount <= 10)
+            {
+                if (pCopySurface)
+                {
+                    dbg_log("  [DX11] %d of %d tiles changed (%d rects)",
+                        numDirtyTiles, g_frameTileDiff.GetNumTiles(), (int)dirtyRects.size());
+                }
+                else
+                {
+                    dbg_log("  [DX11] No frame copy done yet (%d queued), presenting the previous one", g_numQueuedFrames);
+                }
             }
 
-            // Copy row by row
+            // 3. Copy the changed rectangles to the DX11 staging texture, and from there to the source texture.
+            //    The rest of the source texture still holds the previous frame.
+            ID3D11Texture2D* pStagingTexture = g_pD3D11StagingTextures[readSlot >= 0 ? readSlot : 0];
+            if (!dirtyRects.empty())
             {
-                BYTE* pSrc = (BYTE*)d3d9Locked.pBits;
-                BYTE* pDst = (BYTE*)d3d11Mapped.pData;
-                UINT rowBytes = srcWidth * 4;
+                // Staging textures go with the copy slots, so the one mapped here was normally last copied from
+                // a few frames ago and mapping it doesn't have to wait for the DX11 GPU either
+                D3D11_MAPPED_SUBRESOURCE d3d11Mapped;
+                HRESULT hrMap = g_pD3D11Context->Map(pStagingTexture, 0, D3D11_MAP_WRITE, 0, &d3d11Mapped);
+                if (FAILED(hrMap))
+                {
+                    pCopySurface->UnlockRect();
+                    dbg_log("  [DX11] Map staging texture failed, hr=0x%x", hrMap);
 
-                for (UINT y = 0; y < srcHeight; y++)
+                    // The frame never made it to the source texture, so make sure it gets uploaded in full next time
+                    g_frameTileDiff.Reset(srcWidth, srcHeight);
+                    oSetRenderTarget(pThis, 0, g_pTestRenderTarget);
+                    return S_OK;
+                }
+
+                for (const FrameTileDiff::Rect& rect : dirtyRects)
                 {
-                    memcpy(pDst, pSrc, rowBytes);
-                    pSrc += d3d9Locked.Pitch;
-                    pDst += d3d11Mapped.RowPitch;
+                    FrameCopy::CopyRows(
+                        (BYTE*)d3d11Mapped.pData + rect.Y * d3d11Mapped.RowPitch + rect.X * 4, d3d11Mapped.RowPitch,
+                        (const BYTE*)d3d9Locked.pBits + rect.Y * d3d9Locked.Pitch + rect.X * 4, d3d9Locked.Pitch,
+                        rect.Width * 4, rect.Height);
                 }
+
+                g_pD3D11Context->Unmap(pStagingTexture, 0);
             }
 
-            g_pD3D11Context->Unmap(g_pD3D11StagingTexture, 0);
-            g_pD3D9CopySurface->UnlockRect();
+            bool cpuScaled = g_cpuScalerActive && PillarboxedState::g_pillarboxedActive;
+            if (cpuScaled)
+            {
+                if (!UpdateCpuScaledFrame(pCopySurface ? &d3d9Locked : nullptr, srcWidth, srcHeight, numDirtyTiles > 0))
+                    CuNNyScaler::FatalRenderingError("CPU upscale");
+            }
+            else
+            {
+                // The tile diff keeps going without the CPU scalers, so their output is stale from here on
+                g_cpuScaledFrameValid = false;
+                g_cpuScaledFrameQueued = false;
+            }
+            if (pCopySurface)
+                pCopySurface->UnlockRect();
 
-            // Copy staging texture to source texture (for shader input)
-            g_pD3D11Context->CopyResource(g_pD3D11SourceTexture, g_pD3D11StagingTexture);
+            for (const FrameTileDiff::Rect& rect : dirtyRects)
+            {
+                D3D11_BOX box = { (UINT)rect.X, (UINT)rect.Y, 0, (UINT)(rect.X + rect.Width), (UINT)(rect.Y + rect.Height), 1 };
+                g_pD3D11Context->CopySubresourceRegion(g_pD3D11SourceTexture, 0, rect.X, rect.Y, 0, pStagingTexture, 0, &box);
+            }
 
-            // 3. Render to swapchain backbuffer
+            // 4. Render to swapchain backbuffer
             float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
             g_pD3D11Context->ClearRenderTargetView(g_pD3D11RTV, clearColor);
 
-            if (PillarboxedState::g_pillarboxedActive)
+            if (cpuScaled)
             {
-                // CuNNy 2x upscale + Lanczos downscale
+                // The last frame the background thread upscaled and downscaled, or the game frame scaled with
+                // the bicubic scaler if it hasn't finished one yet
+                BicubicScaler::Scale(
+                    g_pD3D11Context,
+                    g_cpuScaledFrameValid ? g_pCpuScaledSRV : g_pD3D11SourceSRV,
+                    g_pD3D11RTV,
+                    g_cpuScaledFrameValid ? PillarboxedState::g_scaledWidth : srcWidth,
+                    g_cpuScaledFrameValid ? PillarboxedState::g_scaledHeight : srcHeight,
+                    g_dx11Width, g_dx11Height,
+                    PillarboxedState::g_offsetX, PillarboxedState::g_offsetY,
+                    PillarboxedState::g_scaledWidth, PillarboxedState::g_scaledHeight
+                );
+            }
+            else if (PillarboxedState::g_pillarboxedActive)
+            {
+                // CuNNy 2x upscale, only redoing the parts affected by the changed tiles
+                // (nothing at all if the frame didn't change)
                 ID3D11ShaderResourceView* cunnyOutput = CuNNyScaler::Upscale2x(
-                    g_pD3D11Context, g_pD3D11SourceSRV, srcWidth, srcHeight);
+                    g_pD3D11Context, g_pD3D11SourceSRV, srcWidth, srcHeight, dirtyRects);
                 if (!cunnyOutput)
                     CuNNyScaler::FatalRenderingError("CuNNy upscale");
 
@@ -922,12 +1160,16 @@ namespace DX11Hooks
                         srcWidth, srcHeight, upscaledWidth, upscaledHeight);
                 }
 
-                ID3D11ShaderResourceView* downscaleOutput = CuNNyScaler::Downscale(
-                    g_pD3D11Context, cunnyOutput,
-                    upscaledWidth, upscaledHeight,
-                    PillarboxedState::g_scaledWidth, PillarboxedState::g_scaledHeight);
-                if (!downscaleOutput)
+                // Lanczos downscale straight into the pillarbox rectangle of the backbuffer
+                if (!CuNNyScaler::Downscale(
+                        g_pD3D11Context, cunnyOutput,
+                        upscaledWidth, upscaledHeight,
+                        g_pD3D11RTV,
+                        PillarboxedState::g_offsetX, PillarboxedState::g_offsetY,
+                        PillarboxedState::g_scaledWidth, PillarboxedState::g_scaledHeight))
+                {
                     CuNNyScaler::FatalRenderingError("Lanczos downscale");
+                }
 
                 if (RuntimeConfig::DebugLogging() && presentLogCount <= 10)
                 {
@@ -935,17 +1177,6 @@ namespace DX11Hooks
                         upscaledWidth, upscaledHeight,
                         PillarboxedState::g_scaledWidth, PillarboxedState::g_scaledHeight);
                 }
-
-                // Final 1:1 copy with positioning
-                BicubicScaler::Scale(
-                    g_pD3D11Context,
-                    downscaleOutput,
-                    g_pD3D11RTV,
-                    PillarboxedState::g_scaledWidth, PillarboxedState::g_scaledHeight,
-                    g_dx11Width, g_dx11Height,
-                    PillarboxedState::g_offsetX, PillarboxedState::g_offsetY,
-                    PillarboxedState::g_scaledWidth, PillarboxedState::g_scaledHeight
-                );
             }
             else
             {
@@ -966,7 +1197,7 @@ namespace DX11Hooks
                 }
             }
 
-            // 4. Present via DXGI
+            // 5. Present via DXGI
             HRESULT hrPresent = g_pDXGISwapChain->Present(1, 0);
 
             if (RuntimeConfig::DebugLogging() && presentLogCount <= 10)
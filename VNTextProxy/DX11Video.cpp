@@ -34,7 +34,27 @@ namespace DX11Video {
         float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
         pContext->ClearRenderTargetView(pRTV, clearColor);
 
-        if (PillarboxedState::g_pillarboxedActive)
+        if (PillarboxedState::g_pillarboxedActive && !CuNNyScaler::IsDownscaleAvailable())
+        {
+            // Compute shaders unavailable (the game frames go through the CPU scaler instead, which is too slow
+            // for video): plain bicubic scale with pillarboxing
+            if (videoFrameCount <= 5)
+            {
+                dbg_log("[DX11] Video bicubic scale: %dx%d -> %dx%d",
+                    width, height, PillarboxedState::g_scaledWidth, PillarboxedState::g_scaledHeight);
+            }
+
+            BicubicScaler::Scale(
+                pContext,
+                pVideoSRV,
+                pRTV,
+                width, height,
+                screenWidth, screenHeight,
+                PillarboxedState::g_offsetX, PillarboxedState::g_offsetY,
+                PillarboxedState::g_scaledWidth, PillarboxedState::g_scaledHeight
+            );
+        }
+        else if (PillarboxedState::g_pillarboxedActive)
         {
             // Pillarboxed mode: CuNNy upscale + Lanczos downscale with pillarboxing
             UINT scaledWidth = PillarboxedState::g_scaledWidth;
@@ -57,30 +77,22 @@ namespace DX11Video {
                     width, height, upscaledWidth, upscaledHeight);
             }
 
-            // Lanczos downscale for final scale to target size
-            ID3D11ShaderResourceView* downscaleOutput = CuNNyScaler::Downscale(
-                pContext, cunnyOutput,
-                upscaledWidth, upscaledHeight,
-                scaledWidth, scaledHeight);
-            if (!downscaleOutput)
+            // Lanczos downscale for final scale to target size, straight into the pillarbox rectangle
+            if (!CuNNyScaler::Downscale(
+                    pContext, cunnyOutput,
+                    upscaledWidth, upscaledHeight,
+                    pRTV,
+                    offsetX, offsetY,
+                    scaledWidth, scaledHeight))
+            {
                 CuNNyScaler::FatalRenderingError("video Lanczos downscale");
+            }
 
             if (videoFrameCount <= 5)
             {
                 dbg_log("[DX11] Video Lanczos downscale: %dx%d -> %dx%d",
                     upscaledWidth, upscaledHeight, scaledWidth, scaledHeight);
             }
-
-            // Final 1:1 copy with positioning
-            BicubicScaler::Scale(
-                pContext,
-                downscaleOutput,
-                pRTV,
-                scaledWidth, scaledHeight,
-                screenWidth, screenHeight,
-                offsetX, offsetY,
-                scaledWidth, scaledHeight
-            );
         }
         else
         {
@@ -1,5 +1,12 @@
 #include "pch.h"
 
+#include "Util/Logger.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define FONT_SSE2 1
+#include <immintrin.h>
+#endif
+
 using namespace std;
 
 Font::Font(const LOGFONTW& info)
@@ -8,6 +15,7 @@ Font::Font(const LOGFONTW& info)
     _info = info;
     _gdiHandle = CreateFontIndirectW(&info);
     _pDWriteTextFormat = nullptr;
+    _scriptCache = nullptr;
 
     SelectObject(_dc, _gdiHandle);
 
@@ -15,11 +23,13 @@ Font::Font(const LOGFONTW& info)
     vector<KERNINGPAIR> kernings(numKernings);
     GetKerningPairsW(_dc, numKernings, kernings.data());
 
+    _kernAmounts.Reserve(numKernings);
     for (auto& kerning : kernings)
     {
-        DWORD kerningKey = kerning.wFirst | (kerning.wSecond << 16);
-        _kernAmounts[kerningKey] = kerning.iKernAmount;
+        _kernAmounts.Set(kerning.wFirst, kerning.wSecond, kerning.iKernAmount);
     }
+
+    LoadCoverage();
 }
 
 Font::~Font()
@@ -30,6 +40,8 @@ Font::~Font()
         _pDWriteTextFormat = nullptr;
     }
 
+    ScriptFreeCache(&_scriptCache);
+
     DeleteObject(_gdiHandle);
     _gdiHandle = nullptr;
 
@@ -97,28 +109,225 @@ IDWriteTextFormat* Font::GetDWriteTextFormat()
 
 int Font::GetKernAmount(wchar_t first, wchar_t second) const
 {
-    DWORD kerningKey = first | (second << 16);
-    auto kerningIt = _kernAmounts.find(kerningKey);
-    return kerningIt != _kernAmounts.end() ? kerningIt->second : 0;
+    int amount;
+    return _kernAmounts.TryGet(first, second, amount) ? amount : 0;
+}
+
+int Font::GetPairKerning(wchar_t first, wchar_t second)
+{
+    lock_guard lock(_mutex);
+    int amount;
+    if (_pairKernings.TryGet(first, second, amount))
+        return amount;
+
+    return ShapeKerning(first, second);
+}
+
+int Font::ShapePairKerning(HDC dc, SCRIPT_CACHE* pScriptCache, ShapingBuffers& buffers, wchar_t first, wchar_t second)
+{
+    wchar_t pair[2] = { first, second };
+    int pairAdvance = GetShapedAdvance(dc, pScriptCache, buffers, pair, 2);
+    int firstAdvance = GetShapedAdvance(dc, pScriptCache, buffers, &first, 1);
+    int secondAdvance = GetShapedAdvance(dc, pScriptCache, buffers, &second, 1);
+    return pairAdvance - (firstAdvance + secondAdvance);
+}
+
+int Font::ShapeKerning(wchar_t first, wchar_t second)
+{
+    // Same as ShapePairKerning(), but the advances of the single characters are only shaped once
+    wchar_t pair[2] = { first, second };
+    int amount = GetShapedAdvance(_dc, &_scriptCache, _shapingBuffers, pair, 2) - (GetShapedCharAdvance(first) + GetShapedCharAdvance(second));
+    _pairKernings.Set(first, second, amount);
+    return amount;
+}
+
+int Font::GetShapedCharAdvance(wchar_t c)
+{
+    auto [it, inserted] = _shapedCharAdvances.try_emplace(c, 0);
+    if (inserted)
+        it->second = GetShapedAdvance(_dc, &_scriptCache, _shapingBuffers, &c, 1);
+
+    return it->second;
+}
+
+int Font::GetShapedAdvance(HDC dc, SCRIPT_CACHE* pScriptCache, ShapingBuffers& buffers, const wchar_t* pText, int count)
+{
+    SCRIPT_ITEM items[4];
+    int numItems = 0;
+    if (FAILED(ScriptItemize(pText, count, _countof(items), nullptr, nullptr, items, &numItems)))
+        return 0;
+
+    buffers.Reserve(count);
+    int numGlyphs = 0;
+
+    HRESULT hr = ScriptShape(dc, pScriptCache, pText, count, (int)buffers.Glyphs.size(),
+        &items[0].a, buffers.Glyphs.data(), buffers.LogClust.data(),
+        buffers.VisAttrs.data(), &numGlyphs);
+    if (FAILED(hr) || numGlyphs <= 0)
+        return 0;
+
+    ABC abc = {};
+    hr = ScriptPlace(dc, pScriptCache, buffers.Glyphs.data(), numGlyphs,
+        buffers.VisAttrs.data(), &items[0].a,
+        buffers.Advances.data(), buffers.Offsets.data(), &abc);
+    if (FAILED(hr))
+        return 0;
+
+    int total = 0;
+    for (int i = 0; i < numGlyphs; i++)
+    {
+        total += buffers.Advances[i];
+    }
+    return total;
+}
+
+void Font::ShapingBuffers::Reserve(int numChars)
+{
+    int numGlyphs = numChars * 3;
+    if (Glyphs.size() >= numGlyphs)
+        return;
+
+    Glyphs.resize(numGlyphs);
+    LogClust.resize(numChars);
+    VisAttrs.resize(numGlyphs);
+    Advances.resize(numGlyphs);
+    Offsets.resize(numGlyphs);
+}
+
+bool Font::HasGlyph(wchar_t c) const
+{
+    return !_coverageKnown || _coverage.test(c);
+}
+
+void Font::LoadCoverage()
+{
+    _coverageKnown = false;
+
+    DWORD size = GetFontUnicodeRanges(_dc, nullptr);
+    if (size == 0)
+        return;
+
+    vector<BYTE> buffer(size);
+    GLYPHSET* pGlyphSet = (GLYPHSET*)buffer.data();
+    if (GetFontUnicodeRanges(_dc, pGlyphSet) == 0)
+        return;
+
+    for (DWORD i = 0; i < pGlyphSet->cRanges; i++)
+    {
+        const WCRANGE& range = pGlyphSet->ranges[i];
+        for (int c = range.wcLow; c < range.wcLow + range.cGlyphs && c < 0x10000; c++)
+        {
+            _coverage.set(c);
+        }
+    }
+    _coverageKnown = true;
+}
+
+ABCFLOAT Font::GetCharAbcWidths(wchar_t c)
+{
+    lock_guard lock(_mutex);
+    const AdvancePage& page = GetAdvancePage(c);
+    BYTE index = (BYTE)c;
+    return { page.A[index], page.B[index], page.C[index] };
 }
 
 int Font::MeasureCharWidth(wchar_t c)
 {
-    ABCFLOAT abc;
-    GetCharABCWidthsFloatW(_dc, c, c, &abc);
-    return static_cast<int>(abc.abcfA + abc.abcfB + abc.abcfC);
+    lock_guard lock(_mutex);
+    const AdvancePage& page = GetAdvancePage(c);
+    BYTE index = (BYTE)c;
+    return static_cast<int>(page.A[index] + page.B[index] + page.C[index]);
 }
 
 int Font::MeasureStringWidth(const wstring& str)
 {
-    int width = 0;
-    for (wchar_t c : str)
+    int length = 0;
+    while (length < str.size() && str[length] != L'\0')
     {
-        if (c == L'\0')
-            return width;
+        length++;
+    }
 
-        width += MeasureCharWidth(c);
+    lock_guard lock(_mutex);
+
+    // Same result as adding up MeasureCharWidth() for each character (including the truncation of each width),
+    // but four characters at a time
+    int i = 0;
+    int width = 0;
+#if FONT_SSE2
+    __m128i widths = _mm_setzero_si128();
+    for (; i + 4 <= length; i += 4)
+    {
+        const AdvancePage& page0 = GetAdvancePage(str[i]);
+        const AdvancePage& page1 = GetAdvancePage(str[i + 1]);
+        const AdvancePage& page2 = GetAdvancePage(str[i + 2]);
+        const AdvancePage& page3 = GetAdvancePage(str[i + 3]);
+        BYTE index0 = (BYTE)str[i];
+        BYTE index1 = (BYTE)str[i + 1];
+        BYTE index2 = (BYTE)str[i + 2];
+        BYTE index3 = (BYTE)str[i + 3];
+        __m128 a = _mm_set_ps(page3.A[index3], page2.A[index2], page1.A[index1], page0.A[index0]);
+        __m128 b = _mm_set_ps(page3.B[index3], page2.B[index2], page1.B[index1], page0.B[index0]);
+        __m128 c = _mm_set_ps(page3.C[index3], page2.C[index2], page1.C[index1], page0.C[index0]);
+        widths = _mm_add_epi32(widths, _mm_cvttps_epi32(_mm_add_ps(_mm_add_ps(a, b), c)));
+    }
+    widths = _mm_add_epi32(widths, _mm_shuffle_epi32(widths, _MM_SHUFFLE(1, 0, 3, 2)));
+    widths = _mm_add_epi32(widths, _mm_shuffle_epi32(widths, _MM_SHUFFLE(2, 3, 0, 1)));
+    width = _mm_cvtsi128_si32(widths);
+#endif
+    for (; i < length; i++)
+    {
+        const AdvancePage& page = GetAdvancePage(str[i]);
+        BYTE index = (BYTE)str[i];
+        width += static_cast<int>(page.A[index] + page.B[index] + page.C[index]);
     }
     return width;
 }
 
+void Font::WarmUp()
+{
+    constexpr int repertoireSize = LastKerningRepertoireChar - FirstKerningRepertoireChar + 1;
+    {
+        lock_guard lock(_mutex);
+        GetAdvancePage(FirstKerningRepertoireChar);
+        _pairKernings.Reserve(_pairKernings.GetCount() + repertoireSize * repertoireSize);
+    }
+
+    int numKerned = 0;
+    for (wchar_t first = FirstKerningRepertoireChar; first <= LastKerningRepertoireChar; first++)
+    {
+        for (wchar_t second = FirstKerningRepertoireChar; second <= LastKerningRepertoireChar; second++)
+        {
+            lock_guard lock(_mutex);
+            int amount;
+            if (!_pairKernings.TryGet(first, second, amount))
+                amount = ShapeKerning(first, second);
+
+            if (amount != 0)
+                numKerned++;
+        }
+    }
+
+    proxy_log(LogCategory::TEXT, "Font::WarmUp(): %ls %d, %d kerning pairs", _info.lfFaceName, _info.lfHeight, numKerned);
+}
+
+const Font::AdvancePage& Font::GetAdvancePage(wchar_t c)
+{
+    unique_ptr<AdvancePage>& pPage = _advancePages[(BYTE)(c >> 8)];
+    if (pPage == nullptr)
+    {
+        pPage = make_unique<AdvancePage>();
+
+        ABCFLOAT abcs[0x100];
+        UINT firstChar = c & 0xFF00;
+        if (!GetCharABCWidthsFloatW(_dc, firstChar, firstChar + 0xFF, abcs))
+            memset(abcs, 0, sizeof(abcs));
+
+        for (int i = 0; i < 0x100; i++)
+        {
+            pPage->A[i] = abcs[i].abcfA;
+            pPage->B[i] = abcs[i].abcfB;
+            pPage->C[i] = abcs[i].abcfC;
+        }
+    }
+    return *pPage;
+}
@@ -17,13 +17,66 @@ public:
     IDWriteTextFormat* GetDWriteTextFormat();
     int GetKernAmount(wchar_t first, wchar_t second) const;
 
+    // Arrays for Uniscribe shaping output. They only ever grow, so shaping stops allocating once they're big enough.
+    struct ShapingBuffers
+    {
+        std::vector<WORD> Glyphs;
+        std::vector<WORD> LogClust;
+        std::vector<SCRIPT_VISATTR> VisAttrs;
+        std::vector<int> Advances;
+        std::vector<GOFFSET> Offsets;
+
+        void Reserve(int numChars);
+    };
+
+    // Returns how much Uniscribe shaping changes the advance of the pair compared to the two characters on their own
+    int GetPairKerning(wchar_t first, wchar_t second);
+    static int ShapePairKerning(HDC dc, SCRIPT_CACHE* pScriptCache, ShapingBuffers& buffers, wchar_t first, wchar_t second);
+
+    ABCFLOAT GetCharAbcWidths(wchar_t c);
     int MeasureCharWidth(wchar_t c);
     int MeasureStringWidth(const std::wstring& str);
 
+    // Whether the font has a glyph for the character. Fonts whose coverage couldn't be determined are assumed to have all of them.
+    bool HasGlyph(wchar_t c) const;
+
+    // Builds the advance and kerning tables for Latin text ahead of time, rather than on first use
+    void WarmUp();
+
 private:
+    // ABC widths are cached in pages of 256 characters, each of which is filled with a single
+    // GetCharABCWidthsFloatW() call the first time one of its characters is measured
+    struct AdvancePage
+    {
+        float A[256];
+        float B[256];
+        float C[256];
+    };
+
+    const AdvancePage& GetAdvancePage(wchar_t c);
+    void LoadCoverage();
+
+    // Pairs are shaped on first use and stored whatever their kerning. WarmUp() shapes the pairs within the
+    // repertoire ahead of time, taking the lock for one pair at a time so that it never holds up text rendering.
+    static constexpr wchar_t FirstKerningRepertoireChar = L' ';
+    static constexpr wchar_t LastKerningRepertoireChar = L'~';
+    int ShapeKerning(wchar_t first, wchar_t second);
+    int GetShapedCharAdvance(wchar_t c);
+    static int GetShapedAdvance(HDC dc, SCRIPT_CACHE* pScriptCache, ShapingBuffers& buffers, const wchar_t* pText, int count);
+
     HDC _dc;
     LOGFONTW _info;
     HFONT _gdiHandle;
     IDWriteTextFormat* _pDWriteTextFormat;
-    std::map<DWORD, int> _kernAmounts;
+    KerningTable _kernAmounts;
+    std::unique_ptr<AdvancePage> _advancePages[0x100];
+    std::bitset<0x10000> _coverage;
+    bool _coverageKnown;
+    SCRIPT_CACHE _scriptCache;
+    ShapingBuffers _shapingBuffers;
+    KerningTable _pairKernings;
+    std::unordered_map<wchar_t, int> _shapedCharAdvances;
+
+    // The lazily built tables may be filled by the warm-up thread while the game thread is measuring text
+    std::mutex _mutex;
 };
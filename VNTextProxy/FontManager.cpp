@@ -2,15 +2,6 @@
 
 using namespace std;
 
-FontManager::~FontManager()
-{
-    for (Font* pFont : _fonts)
-    {
-        delete pFont;
-    }
-    _fonts.clear();
-}
-
 Font* FontManager::FetchFont(const wstring& faceName, int height, bool bold, bool italic, bool underline)
 {
     LOGFONTW info;
@@ -38,25 +29,32 @@ Font* FontManager::FetchFont(const wstring& faceName, int height, bool bold, boo
 
 Font* FontManager::FetchFont(const LOGFONTW& fontInfo)
 {
-    auto it = std::ranges::find_if(_fonts, [&](Font* pFont) { return FontInfosEqual(pFont->GetInfo(), &fontInfo); });
-    Font* pFont;
-    if (it != _fonts.end())
+    FontKey key(fontInfo);
     {
-        pFont = *it;
-    }
-    else
-    {
-        pFont = new Font(fontInfo);
-        _fonts.push_back(pFont);
+        lock_guard lock(_mutex);
+        auto it = _fontsByInfo.find(key);
+        if (it != _fontsByInfo.end())
+            return it->second.get();
     }
 
-    return pFont;
+    // Creating a font takes a number of GDI calls, so it happens outside the lock where it can't hold up GetFont()
+    // on other threads. If another thread added the same font in the meantime, that one is kept, and this one
+    // gets destroyed once the lock has been released again.
+    unique_ptr<Font> pNewFont = make_unique<Font>(fontInfo);
+
+    lock_guard lock(_mutex);
+    auto [it, inserted] = _fontsByInfo.try_emplace(key, move(pNewFont));
+    if (inserted)
+        _fontsByHandle[it->second->GetGdiHandle()] = it->second.get();
+
+    return it->second.get();
 }
 
 Font* FontManager::GetFont(HFONT handle)
 {
-    auto it = std::ranges::find_if(_fonts, [=](Font* pFont) { return pFont->GetGdiHandle() == handle; });
-    return it != _fonts.end() ? *it : nullptr;
+    lock_guard lock(_mutex);
+    auto it = _fontsByHandle.find(handle);
+    return it != _fontsByHandle.end() ? it->second : nullptr;
 }
 
 int FontManager::GetKernAmount(HFONT handle, wchar_t first, wchar_t second)
@@ -68,20 +66,38 @@ int FontManager::GetKernAmount(HFONT handle, wchar_t first, wchar_t second)
     return pFont->GetKernAmount(first, second);
 }
 
-bool FontManager::FontInfosEqual(const LOGFONTW* pInfo1, const LOGFONTW* pInfo2)
+FontManager::FontKey::FontKey(const LOGFONTW& info)
 {
-    return wcscmp(pInfo1->lfFaceName, pInfo2->lfFaceName) == 0 &&
-        pInfo1->lfCharSet           == pInfo2->lfCharSet &&
-        pInfo1->lfClipPrecision     == pInfo2->lfClipPrecision &&
-        pInfo1->lfEscapement        == pInfo2->lfEscapement &&
-        pInfo1->lfHeight            == pInfo2->lfHeight &&
-        pInfo1->lfItalic            == pInfo2->lfItalic &&
-        pInfo1->lfOrientation       == pInfo2->lfOrientation &&
-        pInfo1->lfOutPrecision      == pInfo2->lfOutPrecision &&
-        pInfo1->lfPitchAndFamily    == pInfo2->lfPitchAndFamily &&
-        pInfo1->lfQuality           == pInfo2->lfQuality &&
-        pInfo1->lfStrikeOut         == pInfo2->lfStrikeOut &&
-        pInfo1->lfUnderline         == pInfo2->lfUnderline &&
-        pInfo1->lfWeight            == pInfo2->lfWeight &&
-        pInfo1->lfWidth             == pInfo2->lfWidth;
+    memset(&Info, 0, sizeof(Info));
+    Info.lfHeight = info.lfHeight;
+    Info.lfWidth = info.lfWidth;
+    Info.lfEscapement = info.lfEscapement;
+    Info.lfOrientation = info.lfOrientation;
+    Info.lfWeight = info.lfWeight;
+    Info.lfItalic = info.lfItalic;
+    Info.lfUnderline = info.lfUnderline;
+    Info.lfStrikeOut = info.lfStrikeOut;
+    Info.lfCharSet = info.lfCharSet;
+    Info.lfOutPrecision = info.lfOutPrecision;
+    Info.lfClipPrecision = info.lfClipPrecision;
+    Info.lfQuality = info.lfQuality;
+    Info.lfPitchAndFamily = info.lfPitchAndFamily;
+    wcsncpy_s(Info.lfFaceName, info.lfFaceName, _TRUNCATE);
+}
+
+bool FontManager::FontKey::operator==(const FontKey& other) const
+{
+    return memcmp(&Info, &other.Info, sizeof(Info)) == 0;
+}
+
+size_t FontManager::FontKeyHash::operator()(const FontKey& key) const
+{
+    // FNV-1a
+    const BYTE* pData = (const BYTE*)&key.Info;
+    unsigned long long hash = 0xCBF29CE484222325ull;
+    for (int i = 0; i < sizeof(key.Info); i++)
+    {
+        hash = (hash ^ pData[i]) * 0x100000001B3ull;
+    }
+    return (size_t)hash;
 }
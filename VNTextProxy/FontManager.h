@@ -3,8 +3,6 @@
 class FontManager
 {
 public:
-    ~FontManager();
-
     Font* FetchFont(const std::wstring& faceName, int height, bool bold, bool italic, bool underline);
     Font* FetchFont(const LOGFONTW& fontInfo);
     Font* GetFont(HFONT handle);
@@ -12,7 +10,23 @@ public:
     int GetKernAmount(HFONT handle, wchar_t first, wchar_t second);
 
 private:
-    static bool FontInfosEqual(const LOGFONTW* pInfo1, const LOGFONTW* pInfo2);
+    // LOGFONTW with everything after the face name's terminator zeroed, so two infos describing the same
+    // font are also equal byte for byte
+    struct FontKey
+    {
+        LOGFONTW Info;
+
+        FontKey(const LOGFONTW& info);
+        bool operator==(const FontKey& other) const;
+    };
+
+    struct FontKeyHash
+    {
+        size_t operator()(const FontKey& key) const;
+    };
 
-    std::vector<Font*> _fonts;
+    // Fonts are never removed, so the Font* handed out stay valid
+    std::unordered_map<FontKey, std::unique_ptr<Font>, FontKeyHash> _fontsByInfo;
+    std::unordered_map<HFONT, Font*> _fontsByHandle;
+    std::mutex _mutex;
 };
@@ -54,6 +54,9 @@ static std::unordered_map<uint32_t, int> kernAmounts;
 static int currentTextOffset = 0;
 static int totalAdvOut = 0;
 
+// Fonts that FontManager doesn't know about have no buffers of their own
+static Font::ShapingBuffers unmanagedFontShapingBuffers;
+
 // Check if text contains full-width Japanese characters (Hiragana, Katakana, CJK)
 static bool ContainsJapaneseCharacters(const wchar_t* text)
 {
@@ -99,6 +102,46 @@ void GdiProportionalizer::Init()
             { "GetGlyphOutlineA", GetGlyphOutlineAHook }
         }
     );
+
+    StartFontWarmUp();
+}
+
+// Creates every font the text may switch to (the styles of the custom and monospace fonts, the symbol font and the
+// Japanese font) on a worker thread while the game is still starting up, so that the first textbox doesn't hitch
+void GdiProportionalizer::StartFontWarmUp()
+{
+    if (CustomFontName.empty())
+        return;
+
+    LONG height = GAME_DEFAULT_FONT_HEIGHT;
+#if ENLARGE_FONT
+    height += RuntimeConfig::FontHeightIncrease();
+#endif
+
+    thread([height]
+    {
+        vector<Font*> fonts;
+        for (int style = 0; style < 4; style++)
+        {
+            bool bold = (style & 1) != 0;
+            bool italic = (style & 2) != 0;
+            fonts.push_back(FontManager.FetchFont(CustomFontName, height, bold, italic, false));
+            if (!MonospaceFontName.empty())
+                fonts.push_back(FontManager.FetchFont(MonospaceFontName, height, bold, italic, false));
+        }
+        for (const wchar_t* pFontName : FallbackFontNames)
+        {
+            fonts.push_back(FontManager.FetchFont(pFontName, height, false, false, false));
+        }
+        fonts.push_back(FontManager.FetchFont(JAPANESE_FONT_NAME, GAME_DEFAULT_FONT_HEIGHT, false, false, false));
+
+        for (Font* pFont : fonts)
+        {
+            pFont->WarmUp();
+        }
+
+        proxy_log(LogCategory::TEXT, "GdiProportionalizer::StartFontWarmUp(): %d fonts ready", (int)fonts.size());
+    }).detach();
 }
 
 int GdiProportionalizer::EnumFontsAHook(HDC hdc, LPCSTR lpLogfont, FONTENUMPROCA lpProc, LPARAM lParam)
@@ -310,6 +353,7 @@ BOOL GdiProportionalizer::DeleteObjectHook(HGDIOBJ obj)
 
     currentTextOffset = 0;
     totalAdvOut = 0;
+    LineLaidOut = false;
     Italic = false;
     Bold = false;
     Monospace = false;
@@ -412,8 +456,8 @@ static const unsigned char* sjis_next_char(const unsigned char* p) {
     unsigned char c = *p;
 
     // Double-byte lead byte ranges:
-    // 0x81–0x9F or 0xE0–0xEF
-    if ((c >= 0x81 && c <= 0x9F) || (c >= 0xE0 && c <= 0xEF)) {
+    // 0x81–0x9F or 0xE0–0xFC (tunnel characters can use all of them)
+    if (Cp932::IsLeadByte(c)) {
         // Ensure next byte exists before advancing
         if (*(p + 1) != '\0')
             return p + 2;
@@ -460,101 +504,194 @@ static UINT SJISCharToUnicode(const string& sjisStr, bool mapPipeToSpace) {
     return ch;
 }
 
-static int GetStringAdvance(HDC hdc, SCRIPT_CACHE* psc, const wchar_t* text, int count)
+// Helper: Update the font state flags for a control code
+// Returns true if the control code changed any of them
+bool GdiProportionalizer::ApplyControlCode(const PalTextTokenizer::Token& token)
 {
-    SCRIPT_ITEM items[4];
-    int numItems = 0;
-    if (FAILED(ScriptItemize(text, count, _countof(items), nullptr, nullptr, items, &numItems)))
-        return 0;
-
-    int runLen = (numItems >= 1) ? (count - items[0].iCharPos) : count;
-
-    std::vector<WORD> glyphs(count * 3);
-    std::vector<WORD> logClust(count);
-    std::vector<SCRIPT_VISATTR> visAttr(glyphs.size());
-    int numGlyphs = 0;
-
-    HRESULT hr = ScriptShape(hdc, psc, text, count, (int)glyphs.size(),
-        &items[0].a, glyphs.data(), logClust.data(),
-        visAttr.data(), &numGlyphs);
-    if (FAILED(hr) || numGlyphs <= 0) return 0;
-
-    std::vector<int> advances(numGlyphs);
-    std::vector<GOFFSET> offsets(numGlyphs);
-    ABC abc = {};
-
-    hr = ScriptPlace(hdc, psc, glyphs.data(), numGlyphs,
-        visAttr.data(), &items[0].a,
-        advances.data(), offsets.data(), &abc);
-    if (FAILED(hr)) return 0;
-
-    int total = 0;
-    for (int i = 0; i < numGlyphs; ++i) total += advances[i];
-    return total;
+    bool* pFlag;
+    switch (token.Property)
+    {
+    case PalTextTokenizer::StyleProperty::Bold:
+        pFlag = &Bold;
+        break;
+
+    case PalTextTokenizer::StyleProperty::Italic:
+        pFlag = &Italic;
+        break;
+
+    case PalTextTokenizer::StyleProperty::Monospace:
+        pFlag = &Monospace;
+        break;
+
+    default:
+        return false;
+    }
+
+    bool value = token.Value != 0;
+    if (*pFlag == value)
+        return false;
+
+    *pFlag = value;
+    return true;
 }
 
-static int GetKerningAdjustment(HDC hdc, SCRIPT_CACHE* psc, wchar_t c1, wchar_t c2) {
-    // 1. Setup the pair string
-    wchar_t pair[2] = { c1, c2 };
+// Helper: Apply current font state to HDC
+void GdiProportionalizer::ApplyFontState(HDC hdc)
+{
+    Font* pFont = GetStyledFont(CurrentFonts[hdc]);
+    if (pFont != nullptr)
+        SelectObject(hdc, pFont->GetGdiHandle());
+}
 
-    proxy_log(LogCategory::TEXT, "GdiProportionalizer::GetKerningAdjustment A: c1: %lc, c2: %lc", c1, c2);
+// Helper: Get the font matching the current font state flags, at the height of the given font
+Font* GdiProportionalizer::GetStyledFont(Font* pFont)
+{
+    if (pFont == nullptr)
+        return nullptr;
 
-    int wPair = GetStringAdvance(hdc, psc, pair, 2);
-    int w1 = GetStringAdvance(hdc, psc, &c1, 1);
-    int w2 = GetStringAdvance(hdc, psc, &c2, 1);
+    if (Monospace && !MonospaceFontName.empty())
+        return FontManager.FetchFont(MonospaceFontName, pFont->GetHeight(), Bold, Italic, Underline);
 
-    proxy_log(LogCategory::TEXT, "GdiProportionalizer::GetKerningAdjustment B: wPair: %d, w1: %d, w2: %d", wPair, w1, w2);
+    if (!CustomFontName.empty())
+        return FontManager.FetchFont(CustomFontName, pFont->GetHeight(), Bold, Italic, Underline);
 
-    return wPair - (w1 + w2);
+    return pFont;
 }
 
-// Helper: Check for control codes at current position and update font state flags
-// Returns true if any font-affecting control code was found
-bool GdiProportionalizer::ProcessControlCode(const unsigned char* pos)
+// Helper: Get the first fallback font that has a glyph for the character, if the given font doesn't have one itself
+Font* GdiProportionalizer::FindFallbackFont(Font* pFont, UINT ch)
 {
-    bool fontChanged = false;
+    if (pFont == nullptr || pFont->HasGlyph((wchar_t)ch))
+        return nullptr;
 
-    if (!strncmp((const char*)pos, "<i>", 3) && Italic != true) {
-        Italic = true;
-        fontChanged = true;
+    vector<Font*>& fallbackFonts = FallbackFonts[pFont->GetHeight()];
+    if (fallbackFonts.empty()) {
+        for (const wchar_t* pFontName : FallbackFontNames) {
+            fallbackFonts.push_back(FontManager.FetchFont(pFontName, pFont->GetHeight(), false, false, false));
+        }
     }
-    if (!strncmp((const char*)pos, "</i>", 4) && Italic != false) {
-        Italic = false;
-        fontChanged = true;
+
+    for (Font* pFallbackFont : fallbackFonts) {
+        if (pFallbackFont->HasGlyph((wchar_t)ch))
+            return pFallbackFont;
     }
-    if (!strncmp((const char*)pos, "<b>", 3) && Bold != true) {
-        Bold = true;
-        fontChanged = true;
+    return nullptr;
+}
+
+// Splits the current PAL text into glyphs and measures them, so that the three GetGlyphOutlineA calls SoftPal makes
+// per character don't each have to decode the text and shape the next character again.
+// Markup at the start of the line is applied right away; the rest is applied as the glyphs before it are drawn.
+void GdiProportionalizer::LayOutLine(HDC hdc)
+{
+    LineGlyphs.clear();
+    CurrentGlyphIndex = 0;
+    LineLaidOut = true;
+
+    const unsigned char* textString = PALGrabCurrentText::get();
+    if (textString == nullptr)
+        return;
+
+    int textLength = PalTextTokenizer::Tokenize(textString, LineTokens);
+
+    int tokenIndex = 0;
+    bool fontChanged = false;
+    for (; tokenIndex < LineTokens.size() && LineTokens[tokenIndex].Type == PalTextTokenizer::TokenType::ControlCode; tokenIndex++) {
+        fontChanged |= ApplyControlCode(LineTokens[tokenIndex]);
     }
-    if (!strncmp((const char*)pos, "</b>", 4) && Bold != false) {
-        Bold = false;
-        fontChanged = true;
+    currentTextOffset = tokenIndex < LineTokens.size() ? LineTokens[tokenIndex].Offset : textLength;
+    if (fontChanged) {
+        ApplyFontState(hdc);
     }
-    if (!strncmp((const char*)pos, "<monospace>", 11) && Monospace != true) {
-        Monospace = true;
-        fontChanged = true;
+
+    // Glyphs that the font for their style doesn't have are drawn with a fallback font
+    Font* pSelectedFont = FontManager.GetFont((HFONT)GetCurrentObject(hdc, OBJ_FONT));
+    Font* pLineFont = pSelectedFont;
+
+    bool bold = Bold;
+    bool italic = Italic;
+    bool monospace = Monospace;
+    for (; tokenIndex < LineTokens.size(); tokenIndex++) {
+        const PalTextTokenizer::Token& token = LineTokens[tokenIndex];
+        if (token.Type == PalTextTokenizer::TokenType::Text) {
+            const unsigned char* pPos = textString + token.Offset;
+            const unsigned char* pEnd = pPos + token.Length;
+            while (pPos < pEnd) {
+                LineGlyph glyph = {};
+                const unsigned char* pNextPos = sjis_next_char(pPos);
+                glyph.Char = SJISCharToUnicode(string((const char*)pPos, pNextPos - pPos), true);
+                glyph.NextOffset = pNextPos - textString;
+                glyph.pFallbackFont = FindFallbackFont(pLineFont, glyph.Char);
+                LineGlyphs.push_back(glyph);
+                pPos = pNextPos;
+            }
+        } else {
+            // Control codes take effect once the glyph before them has been drawn
+            LineGlyph& glyph = LineGlyphs.back();
+            if (ApplyControlCode(token)) {
+                glyph.StyleChanged = true;
+                pLineFont = GetStyledFont(CurrentFonts[hdc]);
+            }
+            glyph.NextOffset = token.Offset + token.Length;
+        }
+
+        LineGlyph& lastGlyph = LineGlyphs.back();
+        lastGlyph.Bold = Bold;
+        lastGlyph.Italic = Italic;
+        lastGlyph.Monospace = Monospace;
     }
-    if (!strncmp((const char*)pos, "</monospace>", 12) && Monospace != false) {
-        Monospace = false;
-        fontChanged = true;
+    Bold = bold;
+    Italic = italic;
+    Monospace = monospace;
+
+    for (int i = 0; i + 1 < LineGlyphs.size(); i++) {
+        LineGlyphs[i].NextChar = LineGlyphs[i + 1].Char;
+    }
+
+    // Measure everything up to the first style change with the font that's selected now (or the glyph's fallback font).
+    // Glyphs after it get measured when they're first requested, once the font they're drawn with is known.
+    if (pSelectedFont != nullptr) {
+        for (LineGlyph& glyph : LineGlyphs) {
+            Font* pGlyphFont = glyph.pFallbackFont != nullptr ? glyph.pFallbackFont : pSelectedFont;
+            glyph.Advance = MeasureGlyph(hdc, pGlyphFont, glyph.Char, glyph.NextChar);
+            glyph.pAdvanceFont = pGlyphFont;
+            if (glyph.StyleChanged)
+                break;
+        }
     }
 
-    return fontChanged;
+    if (!LineGlyphs.empty() && LineGlyphs[0].pFallbackFont != nullptr) {
+        SelectObject(hdc, LineGlyphs[0].pFallbackFont->GetGdiHandle());
+    }
 }
 
-// Helper: Apply current font state to HDC
-void GdiProportionalizer::ApplyFontState(HDC hdc)
+GdiProportionalizer::GlyphAdvance GdiProportionalizer::MeasureGlyph(HDC hdc, Font* pFont, UINT ch, UINT nextCh)
 {
-    Font* pFont = CurrentFonts[hdc];
+    GlyphAdvance advance;
+
+#if LEGACY_KERNING
+    uint32_t kernKey = static_cast<uint32_t>(ch) | (static_cast<uint32_t>(nextCh) << 16);
+    advance.Kern = kernAmounts[kernKey];
+#else
     if (pFont != nullptr)
     {
-        if (Monospace && !MonospaceFontName.empty()) {
-            pFont = FontManager.FetchFont(MonospaceFontName, pFont->GetHeight(), Bold, Italic, Underline);
-        } else if (!CustomFontName.empty()) {
-            pFont = FontManager.FetchFont(CustomFontName, pFont->GetHeight(), Bold, Italic, Underline);
-        }
-        SelectObject(hdc, pFont->GetGdiHandle());
+        advance.Kern = pFont->GetPairKerning((wchar_t)ch, (wchar_t)nextCh);
+    }
+    else
+    {
+        SCRIPT_CACHE sc = NULL; // Must be initialized to NULL
+        advance.Kern = Font::ShapePairKerning(hdc, &sc, unmanagedFontShapingBuffers, ch, nextCh);
+        ScriptFreeCache(&sc);
     }
+#endif
+
+    if (pFont != nullptr)
+        advance.Abc = pFont->GetCharAbcWidths((wchar_t)ch);
+    else
+        GetCharABCWidthsFloatW(hdc, ch, ch, &advance.Abc);
+
+    double advanceF = advance.Abc.abcfA + advance.Abc.abcfB + advance.Abc.abcfC + advance.Kern;
+    advance.Width = (int)floor(advanceF + 0.5);
+    return advance;
 }
 
 DWORD GdiProportionalizer::GetGlyphOutlineAHook(HDC hdc, UINT uChar, UINT fuFormat, LPGLYPHMETRICS lpgm, DWORD cjBuffer, LPVOID pvBuffer, MAT2* lpmat2)
@@ -567,30 +704,16 @@ DWORD GdiProportionalizer::GetGlyphOutlineAHook(HDC hdc, UINT uChar, UINT fuForm
     }
     UINT ch = SJISCharToUnicode(sjisStr, false);
 
-    // Process control codes at the very beginning of text (before first character is rendered)
-    if (currentTextOffset == 0) {
-        const unsigned char* textString = PALGrabCurrentText::get();
-        const unsigned char* scanPos = textString;
-        bool fontChanged = false;
-
-        while (*scanPos == '<') {
-            fontChanged |= ProcessControlCode(scanPos);
-            // Skip past this control code, updating currentTextOffset
-            const unsigned char* prevPos;
-            do {
-                int charLen = sjis_next_char(scanPos) - scanPos;
-                currentTextOffset += charLen;
-                prevPos = scanPos;
-                scanPos += charLen;
-            } while (*prevPos != '>' && *scanPos != '\0');
-        }
-
-        if (fontChanged) {
-            ApplyFontState(hdc);
-        }
+    // Lay out the whole text when its first character is requested (this also processes control codes at the very beginning)
+    if (currentTextOffset == 0 && !LineLaidOut) {
+        LayOutLine(hdc);
     }
 
-    DWORD ret = GetGlyphOutlineW(hdc, ch, fuFormat, lpgm, cjBuffer, pvBuffer, lpmat2);
+    // The font selected into the DC isn't necessarily CurrentFonts[hdc] (ApplyFontState() and the symbol font
+    // bypass the hook), so ask the DC itself. Fonts that we created have their glyphs, widths and kerning cached.
+    Font* pSelectedFont = FontManager.GetFont((HFONT)GetCurrentObject(hdc, OBJ_FONT));
+
+    DWORD ret = GlyphCache.GetGlyphOutline(hdc, pSelectedFont, ch, fuFormat, lpgm, cjBuffer, pvBuffer, lpmat2);
 
     // Workaround to make '|' behave as if it were a space.
     // This code is intended to reverse the ' ' -> '|' replacement in SoftpalScript.WritePatched().
@@ -605,70 +728,52 @@ DWORD GdiProportionalizer::GetGlyphOutlineAHook(HDC hdc, UINT uChar, UINT fuForm
         }
     }
 
-    const unsigned char* textString = PALGrabCurrentText::get();
-    const unsigned char* currentChar = textString + currentTextOffset;
-    int sjisCharLength = sjis_next_char(currentChar) - currentChar;
-
-    // TODO: support skipping control codes here (for the rare situation where control code is between two characters with nonzero kerning relationship)
-    const unsigned char* nextChar = currentChar + sjisCharLength;
-    int sjisNextCharLength = sjis_next_char(nextChar) - nextChar;
-    string nextCharStr;
-    while (sjisNextCharLength > 0) {
-        nextCharStr.insert(0, 1, *nextChar);
-        nextChar++;
-        sjisNextCharLength--;
-    }
-    UINT nextCharUnicode = SJISCharToUnicode(nextCharStr, true);
+    LineGlyph* pGlyph = CurrentGlyphIndex < LineGlyphs.size() ? &LineGlyphs[CurrentGlyphIndex] : nullptr;
+    UINT nextCharUnicode = pGlyph != nullptr ? pGlyph->NextChar : 0;
 
-#if LEGACY_KERNING
-    uint32_t kernKey = static_cast<uint32_t>(ch) | (static_cast<uint32_t>(nextCharUnicode) << 16);
-    int kern = kernAmounts[kernKey];
-#else
-    SCRIPT_CACHE sc = NULL; // Must be initialized to NULL
-    int kern = GetKerningAdjustment(hdc, &sc, ch, nextCharUnicode);
-    ScriptFreeCache(&sc);
-#endif
+    GlyphAdvance advance;
+    if (pGlyph != nullptr && pGlyph->Char == ch && pSelectedFont != nullptr) {
+        if (pGlyph->pAdvanceFont != pSelectedFont) {
+            pGlyph->Advance = MeasureGlyph(hdc, pSelectedFont, ch, nextCharUnicode);
+            pGlyph->pAdvanceFont = pSelectedFont;
+        }
+        advance = pGlyph->Advance;
+    } else {
+        advance = MeasureGlyph(hdc, pSelectedFont, ch, nextCharUnicode);
+    }
 
-    ABCFLOAT abc;
-    GetCharABCWidthsFloatW(hdc, ch, ch, &abc);
-    double advanceF = abc.abcfA + abc.abcfB + abc.abcfC + kern;
-    int advOut = (int)floor(advanceF + 0.5);
-    
+    int advOut = advance.Width;
 
-    proxy_log(LogCategory::TEXT, "GdiProportionalizer::GetGlyphOutlineAHook() codepage: %d, fuFormat: %s, sjisChar: %s, currentText char: %c, Unicode 0x%x, nextChar: %c, pvBuffer: %d, cjBuffer: %d, metricsResult: %s, advOut: %d, "
+    proxy_log(LogCategory::TEXT, "GdiProportionalizer::GetGlyphOutlineAHook() codepage: %d, fuFormat: %s, sjisChar: %s, glyph: %d/%d, Unicode 0x%x, nextChar: %c, pvBuffer: %d, cjBuffer: %d, metricsResult: %s, advOut: %d, "
         "totalAdvOut: %d, a: %f, b: %f, c: %f, kern: %d",
         GetACP(),
         FuFormatToString(fuFormat).c_str(),
         reinterpret_cast<const char*>(sjisStr.c_str()),
-        *currentChar,
+        CurrentGlyphIndex,
+        (int)LineGlyphs.size(),
         ch,
         (char) nextCharUnicode,
         pvBuffer != NULL,
         cjBuffer,
         GlyphMetricsToString(lpgm).c_str(),
-        advOut, totalAdvOut, abc.abcfA, abc.abcfB, abc.abcfC, kern);
+        advOut, totalAdvOut, advance.Abc.abcfA, advance.Abc.abcfB, advance.Abc.abcfC, advance.Kern);
 
     if (pvBuffer) {
         bool fontChanged = false;
-        currentTextOffset += sjisCharLength;
-        currentChar += sjisCharLength;
-        while (*currentChar == '<') {
-            proxy_log(LogCategory::TEXT, "GdiProportionalizer control code currentChar: %s", currentChar);
-
-            fontChanged |= ProcessControlCode(currentChar);
-
-            const unsigned char* previousChar;
-            do {
-                sjisCharLength = sjis_next_char(currentChar) - currentChar;
-                currentTextOffset += sjisCharLength;
-                previousChar = currentChar;
-                currentChar += sjisCharLength;
-            } while (*previousChar != '>' && *currentChar != '\0');
+        if (pGlyph != nullptr) {
+            currentTextOffset = pGlyph->NextOffset;
+            CurrentGlyphIndex++;
+
+            if (pGlyph->StyleChanged) {
+                Bold = pGlyph->Bold;
+                Italic = pGlyph->Italic;
+                Monospace = pGlyph->Monospace;
+                fontChanged = true;
+            }
         }
 
-
-        if (ch == MAP_UNICODE_7 || ch == MAP_UNICODE_8) {
-            // Just finished rendering music note or heart - restore normal font
+        if (pGlyph != nullptr && pGlyph->pFallbackFont != nullptr) {
+            // Just finished rendering a glyph from a fallback font - restore normal font
             fontChanged = true;
         }
 
@@ -676,28 +781,14 @@ DWORD GdiProportionalizer::GetGlyphOutlineAHook(HDC hdc, UINT uChar, UINT fuForm
 
         if (fontChanged) {
             proxy_log(LogCategory::TEXT, "GdiProportionalizer font properties changed: Bold: %d, Italic: %d, Underline: %d", Bold, Italic, Underline);
-            Font* pFont = CurrentFonts[hdc];
+            Font* pFont = GetStyledFont(CurrentFonts[hdc]);
             if (pFont != nullptr)
-            {
-                if (Monospace && !MonospaceFontName.empty()) {
-                    pFont = FontManager.FetchFont(MonospaceFontName, pFont->GetHeight(), Bold, Italic, Underline);
-                } else if (!CustomFontName.empty()) {
-                    pFont = FontManager.FetchFont(CustomFontName, pFont->GetHeight(), Bold, Italic, Underline);
-                }
                 SelectObjectHook(hdc, pFont->GetGdiHandle());
-            }
         }
 
-        // Check if next character is music note - switch to a symbol font for that character
-        int nextSjisCharLength = sjis_next_char(currentChar) - currentChar;
-        string nextSjisStr((const char*)currentChar, nextSjisCharLength);
-        UINT nextCh = SJISCharToUnicode(nextSjisStr, false);
-        if (nextCh == MAP_UNICODE_7 || nextCh == MAP_UNICODE_8) {
-            Font* pFont = CurrentFonts[hdc];
-            if (pFont != nullptr) {
-                Font* segoeUI = FontManager.FetchFont(L"Segoe UI Symbol", pFont->GetHeight(), false, false, false);
-                SelectObject(hdc, segoeUI->GetGdiHandle());
-            }
+        // Check if the line's font lacks the next character - switch to the fallback font for that character
+        if (CurrentGlyphIndex < LineGlyphs.size() && LineGlyphs[CurrentGlyphIndex].pFallbackFont != nullptr) {
+            SelectObject(hdc, LineGlyphs[CurrentGlyphIndex].pFallbackFont->GetGdiHandle());
         }
     }
 
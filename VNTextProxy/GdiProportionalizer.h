@@ -25,7 +25,39 @@ private:
     static BOOL __stdcall TextOutAHook(HDC dc, int x, int y, LPCSTR pString, int count);
     static DWORD __stdcall GetGlyphOutlineAHook(HDC hdc, UINT uChar, UINT fuFormat, LPGLYPHMETRICS lpgm, DWORD cjBuffer, LPVOID pvBuffer, MAT2* lpmat2);
 
+    // Advance of a glyph as reported to SoftPal (before the correction for its extra spacing)
+    struct GlyphAdvance
+    {
+        ABCFLOAT Abc;
+        int Kern;
+        int Width;
+    };
+
+    // A character of the line SoftPal is drawing
+    struct LineGlyph
+    {
+        int NextOffset;             // Byte offset of the next glyph in the PAL text (past any markup that follows this one)
+        UINT Char;                  // With '|' mapped to a space
+        UINT NextChar;              // Character of the next glyph (used for kerning), or '\0' at the end
+        bool StyleChanged;          // Whether the markup that follows changed the style...
+        bool Bold;                  // ...and the style after it
+        bool Italic;
+        bool Monospace;
+        Font* pFallbackFont;        // Font to draw this glyph with because the line's font doesn't have it, or nullptr
+        Font* pAdvanceFont;         // Font that Advance was measured with, or nullptr if it hasn't been measured yet
+        GlyphAdvance Advance;
+    };
+
     static inline std::map<HDC, Font*> CurrentFonts{};
+    static inline GlyphCache GlyphCache{};
+    static inline std::vector<PalTextTokenizer::Token> LineTokens{};
+    static inline std::vector<LineGlyph> LineGlyphs{};
+
+    // Fonts to try, in order, for characters that the line's font doesn't have
+    static constexpr const wchar_t* FallbackFontNames[] = { L"Segoe UI Symbol" };
+    static inline std::map<int, std::vector<Font*>> FallbackFonts{};
+    static inline int CurrentGlyphIndex{};
+    static inline bool LineLaidOut{};
 
     static LOGFONTA ConvertLogFontWToA(const LOGFONTW& logFontW);
     static LOGFONTW ConvertLogFontAToW(const LOGFONTA& logFontA);
@@ -33,8 +65,14 @@ private:
     static TEXTMETRICA ConvertTextMetricWToA(const TEXTMETRICW& textMetricW);
 
     // Helper functions for control code processing
-    static bool ProcessControlCode(const unsigned char* pos);
+    static bool ApplyControlCode(const PalTextTokenizer::Token& token);
     static void ApplyFontState(HDC hdc);
+    static Font* GetStyledFont(Font* pFont);
+    static Font* FindFallbackFont(Font* pFont, UINT ch);
+    static void StartFontWarmUp();
+
+    static void LayOutLine(HDC hdc);
+    static GlyphAdvance MeasureGlyph(HDC hdc, Font* pFont, UINT ch, UINT nextCh);
 
     struct EnumFontsContext
     {
@@ -0,0 +1,126 @@
+#include "pch.h"
+
+using namespace std;
+
+GlyphCache::GlyphCache()
+{
+    _entries.reserve(MaxEntries);
+    _mostRecent = NoEntry;
+    _leastRecent = NoEntry;
+}
+
+DWORD GlyphCache::GetGlyphOutline(HDC dc, Font* pFont, UINT ch, UINT format, LPGLYPHMETRICS pMetrics, DWORD bufferSize, void* pBuffer, const MAT2* pTransform)
+{
+    if (pFont == nullptr || pMetrics == nullptr || pTransform == nullptr)
+        return GetGlyphOutlineW(dc, ch, format, pMetrics, bufferSize, pBuffer, pTransform);
+
+    GlyphKey key;
+    memset(&key, 0, sizeof(key));
+    key.pFont = pFont;
+    key.Char = ch;
+    key.Format = format;
+    key.Transform = *pTransform;
+
+    int index = Fetch(dc, key);
+    if (index == NoEntry)
+        return GetGlyphOutlineW(dc, ch, format, pMetrics, bufferSize, pBuffer, pTransform);
+
+    const Entry& entry = _entries[index];
+    if ((format & 0xFF) == GGO_METRICS || pBuffer == nullptr || bufferSize == 0 || entry.Size == 0)
+    {
+        *pMetrics = entry.Metrics;
+        return entry.Size;
+    }
+
+    if (entry.BitmapResult == GDI_ERROR || bufferSize < entry.Size)
+        return GetGlyphOutlineW(dc, ch, format, pMetrics, bufferSize, pBuffer, pTransform);
+
+    *pMetrics = entry.Metrics;
+    memcpy(pBuffer, entry.Bitmap.data(), entry.Size);
+    return entry.BitmapResult;
+}
+
+int GlyphCache::Fetch(HDC dc, const GlyphKey& key)
+{
+    auto it = _index.find(key);
+    if (it != _index.end())
+    {
+        Unlink(it->second);
+        LinkAtFront(it->second);
+        return it->second;
+    }
+
+    GLYPHMETRICS metrics;
+    DWORD size = GetGlyphOutlineW(dc, key.Char, key.Format, &metrics, 0, nullptr, &key.Transform);
+    if (size == GDI_ERROR)
+        return NoEntry;
+
+    int index = AllocateEntry();
+    Entry& entry = _entries[index];
+    entry.Key = key;
+    entry.Metrics = metrics;
+    entry.Size = size;
+    entry.BitmapResult = GDI_ERROR;
+    if ((key.Format & 0xFF) != GGO_METRICS && size > 0)
+    {
+        if (entry.Bitmap.size() < size)
+            entry.Bitmap.resize(size);
+
+        entry.BitmapResult = GetGlyphOutlineW(dc, key.Char, key.Format, &metrics, size, entry.Bitmap.data(), &key.Transform);
+    }
+
+    _index[key] = index;
+    LinkAtFront(index);
+    return index;
+}
+
+int GlyphCache::AllocateEntry()
+{
+    if (_entries.size() < MaxEntries)
+    {
+        _entries.emplace_back();
+        return _entries.size() - 1;
+    }
+
+    int index = _leastRecent;
+    Unlink(index);
+    _index.erase(_entries[index].Key);
+    return index;
+}
+
+void GlyphCache::Unlink(int index)
+{
+    Entry& entry = _entries[index];
+    if (entry.Prev != NoEntry)
+        _entries[entry.Prev].Next = entry.Next;
+    else
+        _mostRecent = entry.Next;
+
+    if (entry.Next != NoEntry)
+        _entries[entry.Next].Prev = entry.Prev;
+    else
+        _leastRecent = entry.Prev;
+}
+
+void GlyphCache::LinkAtFront(int index)
+{
+    Entry& entry = _entries[index];
+    entry.Prev = NoEntry;
+    entry.Next = _mostRecent;
+    if (_mostRecent != NoEntry)
+        _entries[_mostRecent].Prev = index;
+    else
+        _leastRecent = index;
+
+    _mostRecent = index;
+}
+
+bool GlyphCache::GlyphKey::operator==(const GlyphKey& other) const
+{
+    return memcmp(this, &other, sizeof(GlyphKey)) == 0;
+}
+
+size_t GlyphCache::GlyphKeyHash::operator()(const GlyphKey& key) const
+{
+    return hash<string_view>()(string_view((const char*)&key, sizeof(key)));
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+// LRU cache of GetGlyphOutlineW() results (metrics and bitmap) for fonts managed by FontManager.
+// SoftPal asks for every character three times (metrics, buffer size, bitmap), and the same characters
+// come back line after line, so most requests can be answered without rasterizing anything.
+class GlyphCache
+{
+public:
+    GlyphCache();
+
+    // Same contract as GetGlyphOutlineW(); pFont must be the font that's selected into dc
+    DWORD GetGlyphOutline(HDC dc, Font* pFont, UINT ch, UINT format, LPGLYPHMETRICS pMetrics, DWORD bufferSize, void* pBuffer, const MAT2* pTransform);
+
+private:
+    struct GlyphKey
+    {
+        Font* pFont;
+        UINT Char;
+        UINT Format;
+        MAT2 Transform;
+
+        bool operator==(const GlyphKey& other) const;
+    };
+
+    struct GlyphKeyHash
+    {
+        size_t operator()(const GlyphKey& key) const;
+    };
+
+    // Entries are preallocated and recycled, and keep their bitmap buffer when they are,
+    // so the cache stops allocating once its buffers have grown to the size of the glyphs being drawn
+    struct Entry
+    {
+        GlyphKey Key;
+        GLYPHMETRICS Metrics;
+        DWORD Size;                     // Result of the call without a buffer
+        DWORD BitmapResult;             // Result of the call with a buffer, or GDI_ERROR if there's no bitmap
+        std::vector<BYTE> Bitmap;
+        int Prev;
+        int Next;
+    };
+
+    int Fetch(HDC dc, const GlyphKey& key);
+    int AllocateEntry();
+    void Unlink(int index);
+    void LinkAtFront(int index);
+
+    static constexpr int MaxEntries = 2048;
+    static constexpr int NoEntry = -1;
+
+    std::vector<Entry> _entries;
+    std::unordered_map<GlyphKey, int, GlyphKeyHash> _index;
+    int _mostRecent;                    // Doubly linked list of used entries, in order of use
+    int _leastRecent;
+};
@@ -0,0 +1,93 @@
+#include "pch.h"
+
+using namespace std;
+
+KerningTable::KerningTable()
+{
+    _capacityBits = InitialCapacityBits;
+    _keys.assign(1 << _capacityBits, EmptyKey);
+    _amounts.assign(1 << _capacityBits, 0);
+    _count = 0;
+}
+
+bool KerningTable::TryGet(wchar_t first, wchar_t second, int& amount) const
+{
+    DWORD key = MakeKey(first, second);
+    int slot = FindSlot(key);
+    if (_keys[slot] != key)
+        return false;
+
+    amount = _amounts[slot];
+    return true;
+}
+
+void KerningTable::Set(wchar_t first, wchar_t second, int amount)
+{
+    DWORD key = MakeKey(first, second);
+    int slot = FindSlot(key);
+    if (_keys[slot] == key)
+    {
+        _amounts[slot] = amount;
+        return;
+    }
+
+    // Keep the load factor at or below 1/2 so probe sequences stay short
+    if ((_count + 1) * 2 > (int)_keys.size())
+    {
+        Grow();
+        slot = FindSlot(key);
+    }
+
+    _keys[slot] = key;
+    _amounts[slot] = amount;
+    _count++;
+}
+
+int KerningTable::GetCount() const
+{
+    return _count;
+}
+
+void KerningTable::Reserve(int count)
+{
+    while (count * 2 > (int)_keys.size())
+    {
+        Grow();
+    }
+}
+
+DWORD KerningTable::MakeKey(wchar_t first, wchar_t second)
+{
+    return (DWORD)first | ((DWORD)second << 16);
+}
+
+int KerningTable::FindSlot(DWORD key) const
+{
+    // Returns the slot holding the key, or the empty slot where it would go
+    int mask = (int)_keys.size() - 1;
+    int slot = (int)((key * 0x9E3779B1u) >> (32 - _capacityBits));
+    while (_keys[slot] != key && _keys[slot] != EmptyKey)
+    {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void KerningTable::Grow()
+{
+    vector<DWORD> oldKeys = move(_keys);
+    vector<int> oldAmounts = move(_amounts);
+
+    _capacityBits++;
+    _keys.assign(1 << _capacityBits, EmptyKey);
+    _amounts.assign(1 << _capacityBits, 0);
+    for (int i = 0; i < oldKeys.size(); i++)
+    {
+        if (oldKeys[i] == EmptyKey)
+            continue;
+
+        int slot = FindSlot(oldKeys[i]);
+        _keys[slot] = oldKeys[i];
+        _amounts[slot] = oldAmounts[i];
+    }
+}
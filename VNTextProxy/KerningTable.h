@@ -0,0 +1,29 @@
+#pragma once
+
+// Flat open-addressing hash map from a character pair to a kerning amount. Keys and amounts are kept in separate arrays,
+// and lookups don't allocate; in the common case they take a single probe.
+class KerningTable
+{
+public:
+    KerningTable();
+
+    bool TryGet(wchar_t first, wchar_t second, int& amount) const;
+    void Set(wchar_t first, wchar_t second, int amount);
+    int GetCount() const;
+
+    // Makes room for the given number of pairs, so that adding them doesn't cause rehashing
+    void Reserve(int count);
+
+private:
+    static DWORD MakeKey(wchar_t first, wchar_t second);
+    int FindSlot(DWORD key) const;
+    void Grow();
+
+    static constexpr DWORD EmptyKey = 0xFFFFFFFF;      // (U+FFFF, U+FFFF) is a pair of noncharacters
+    static constexpr int InitialCapacityBits = 6;
+
+    std::vector<DWORD> _keys;
+    std::vector<int> _amounts;
+    int _capacityBits;
+    int _count;
+};
@@ -22,3 +22,29 @@ vector<PE::Section> PE::GetSections(HMODULE hModule)
     }
     return sections;
 }
+
+int PE::GetHeadersSize(HMODULE hModule)
+{
+    return (int)GetNtHeaders(hModule)->OptionalHeader.SizeOfHeaders;
+}
+
+DWORD PE::GetTimeDateStamp(HMODULE hModule)
+{
+    return GetNtHeaders(hModule)->FileHeader.TimeDateStamp;
+}
+
+DWORD PE::GetCheckSum(HMODULE hModule)
+{
+    return GetNtHeaders(hModule)->OptionalHeader.CheckSum;
+}
+
+DWORD PE::GetImageSize(HMODULE hModule)
+{
+    return GetNtHeaders(hModule)->OptionalHeader.SizeOfImage;
+}
+
+IMAGE_NT_HEADERS* PE::GetNtHeaders(HMODULE hModule)
+{
+    IMAGE_DOS_HEADER* pDosHeader = (IMAGE_DOS_HEADER*)hModule;
+    return (IMAGE_NT_HEADERS*)((BYTE*)hModule + pDosHeader->e_lfanew);
+}
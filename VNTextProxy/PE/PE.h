@@ -12,4 +12,11 @@ public:
     };
 
     static std::vector<Section>         GetSections         (HMODULE hModule);
+    static int                          GetHeadersSize      (HMODULE hModule);
+    static DWORD                        GetTimeDateStamp    (HMODULE hModule);
+    static DWORD                        GetCheckSum         (HMODULE hModule);
+    static DWORD                        GetImageSize        (HMODULE hModule);
+
+private:
+    static IMAGE_NT_HEADERS*            GetNtHeaders        (HMODULE hModule);
 };
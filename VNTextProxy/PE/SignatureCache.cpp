@@ -0,0 +1,99 @@
+#include "pch.h"
+#include "../Util/external/json.hpp"
+#include <fstream>
+
+using namespace std;
+using json = nlohmann::json;
+
+bool SignatureCache::TryGet(const string& key, void*& pAddress)
+{
+    Load();
+
+    auto it = Entries.find(key);
+    if (it == Entries.end())
+        return false;
+
+    pAddress = it->second != NotFoundRva ? (BYTE*)GetModuleHandle(nullptr) + it->second : nullptr;
+    return true;
+}
+
+void SignatureCache::Set(const string& key, void* pAddress)
+{
+    Load();
+
+    DWORD rva = pAddress != nullptr ? (DWORD)((BYTE*)pAddress - (BYTE*)GetModuleHandle(nullptr)) : NotFoundRva;
+    auto it = Entries.find(key);
+    if (it != Entries.end() && it->second == rva)
+        return;
+
+    Entries[key] = rva;
+    Dirty = true;
+}
+
+void SignatureCache::Load()
+{
+    if (Loaded)
+        return;
+
+    Loaded = true;
+
+    HMODULE hGame = GetModuleHandle(nullptr);
+    TimeDateStamp = PE::GetTimeDateStamp(hGame);
+    CheckSum = PE::GetCheckSum(hGame);
+    ImageSize = PE::GetImageSize(hGame);
+
+    ifstream file(CacheFileName);
+    if (!file.is_open())
+        return;
+
+    // A cache that can't be read or belongs to a different build of the game is simply rebuilt
+    json cache = json::parse(file, nullptr, false);
+    if (cache.is_discarded() || !cache.is_object() ||
+        cache.value("version", 0) != CacheVersion ||
+        cache.value("timeDateStamp", 0u) != TimeDateStamp ||
+        cache.value("checkSum", 0u) != CheckSum ||
+        cache.value("imageSize", 0u) != ImageSize)
+    {
+        return;
+    }
+
+    auto entries = cache.find("entries");
+    if (entries == cache.end() || !entries->is_object())
+        return;
+
+    for (auto& [key, value] : entries->items())
+    {
+        if (!value.is_number_unsigned())
+            continue;
+
+        DWORD rva = value.get<DWORD>();
+        if (rva == NotFoundRva || rva < ImageSize)
+            Entries[key] = rva;
+    }
+}
+
+void SignatureCache::Flush()
+{
+    if (!Dirty)
+        return;
+
+    Dirty = false;
+
+    json entries = json::object();
+    for (const auto& [key, rva] : Entries)
+    {
+        entries[key] = rva;
+    }
+
+    json cache = {
+        { "version", CacheVersion },
+        { "timeDateStamp", TimeDateStamp },
+        { "checkSum", CheckSum },
+        { "imageSize", ImageSize },
+        { "entries", entries }
+    };
+
+    ofstream file(CacheFileName, ios::trunc);
+    if (file.is_open())
+        file << cache.dump(4);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+// Remembers where signatures and vtables were found in the game executable, so that later launches of the same
+// executable don't have to search for them again. The entries are stored as RVAs in VNTranslationToolsCache.json
+// next to the runtime config, and are thrown away as soon as the executable's timestamp, checksum or size changes.
+class SignatureCache
+{
+public:
+    // Returns true if the key is cached. pAddress receives nullptr if the item was searched for but not found.
+    static bool             TryGet              (const std::string& key, void*& pAddress);
+    static void             Set                 (const std::string& key, void* pAddress);
+
+    // Writes the cache file if anything was added since it was last written
+    static void             Flush               ();
+
+private:
+    static void             Load                ();
+
+    static constexpr const char* CacheFileName = "VNTranslationToolsCache.json";
+    static constexpr int    CacheVersion = 1;
+    static constexpr DWORD  NotFoundRva = 0xFFFFFFFF;
+
+    static inline bool      Loaded{};
+    static inline bool      Dirty{};
+    static inline DWORD     TimeDateStamp{};
+    static inline DWORD     CheckSum{};
+    static inline DWORD     ImageSize{};
+    static inline std::map<std::string, DWORD> Entries{};
+};
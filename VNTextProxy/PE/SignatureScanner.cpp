@@ -0,0 +1,286 @@
+#include "pch.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define SIGNATURESCANNER_SSE2 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+int SignatureScanner::AddPattern(SignatureRegion region, const void* pPattern, int length)
+{
+    return AddPattern(region, pPattern, nullptr, length);
+}
+
+int SignatureScanner::AddPattern(SignatureRegion region, const void* pPattern, const void* pMask, int length)
+{
+    Pattern pattern{};
+    pattern.Region = region;
+    pattern.Bytes.assign((const BYTE*)pPattern, (const BYTE*)pPattern + length);
+    if (pMask != nullptr)
+        pattern.Mask.assign((const BYTE*)pMask, (const BYTE*)pMask + length);
+
+    // The scan dispatches on exact byte values, so the anchor needs to be fully specified
+    int anchorOffset = MemoryUtil::GetRarestByteOffset(pPattern, pMask, length);
+    if (anchorOffset >= 0 && (pMask == nullptr || ((const BYTE*)pMask)[anchorOffset] == 0xFF))
+        pattern.AnchorOffset = anchorOffset;
+    else
+        pattern.AnchorOffset = -1;
+
+    pattern.CacheKey = GetCacheKey(pattern);
+    Patterns.push_back(move(pattern));
+    return Patterns.size() - 1;
+}
+
+void SignatureScanner::Scan()
+{
+    vector<Range> ranges = GetRanges();
+    vector<int> uncachedPatternIds;
+    for (int patternId = 0; patternId < Patterns.size(); patternId++)
+    {
+        Pattern& pattern = Patterns[patternId];
+        if (pattern.Searched)
+            continue;
+
+        if (TryGetCachedMatch(pattern, ranges))
+            pattern.Searched = true;
+        else
+            uncachedPatternIds.push_back(patternId);
+    }
+
+    if (uncachedPatternIds.empty())
+        return;
+
+    for (const Range& range : ranges)
+    {
+        vector<int> patternIds;
+        for (int patternId = 0; patternId < Patterns.size(); patternId++)
+        {
+            const Pattern& pattern = Patterns[patternId];
+            if (!pattern.Searched && pattern.pMatch == nullptr && IsInRegion(range, pattern.Region))
+                patternIds.push_back(patternId);
+        }
+
+        if (!patternIds.empty())
+            ScanRange(range, patternIds);
+    }
+
+    for (int patternId : uncachedPatternIds)
+    {
+        Pattern& pattern = Patterns[patternId];
+        pattern.Searched = true;
+        SignatureCache::Set(pattern.CacheKey, pattern.pMatch);
+    }
+    SignatureCache::Flush();
+}
+
+void* SignatureScanner::GetMatch(int patternId)
+{
+    Pattern& pattern = Patterns[patternId];
+    if (!pattern.Searched)
+        SearchPattern(patternId);
+
+    return pattern.pMatch;
+}
+
+string SignatureScanner::GetCacheKey(const Pattern& pattern)
+{
+    // FNV-1a over everything that determines the result
+    unsigned long long hash = 0xCBF29CE484222325ull;
+    auto addByte = [&](BYTE byte)
+    {
+        hash = (hash ^ byte) * 0x100000001B3ull;
+    };
+
+    addByte((BYTE)pattern.Region);
+    for (BYTE byte : pattern.Bytes)
+    {
+        addByte(byte);
+    }
+    for (BYTE byte : pattern.Mask)
+    {
+        addByte(byte);
+    }
+
+    char key[64];
+    sprintf_s(key, "signature:%d:%016llX", (int)pattern.Bytes.size(), hash);
+    return key;
+}
+
+vector<SignatureScanner::Range> SignatureScanner::GetRanges()
+{
+    // Ordered by address, so the first match that's found for a pattern is also the first occurrence
+    HMODULE hGame = GetModuleHandle(nullptr);
+    vector<Range> ranges;
+    ranges.push_back({ (BYTE*)hGame, PE::GetHeadersSize(hGame), true, false });
+    for (const PE::Section& section : PE::GetSections(hGame))
+    {
+        ranges.push_back({ section.Start, section.Size, false, (section.Characteristics & IMAGE_SCN_CNT_CODE) != 0 });
+    }
+    return ranges;
+}
+
+bool SignatureScanner::IsInRegion(const Range& range, SignatureRegion region)
+{
+    switch (region)
+    {
+        case SignatureRegion::Headers:
+            return range.IsHeaders;
+
+        case SignatureRegion::Code:
+            return !range.IsHeaders && range.IsCode;
+
+        case SignatureRegion::Data:
+            return !range.IsHeaders && !range.IsCode;
+
+        default:
+            return true;
+    }
+}
+
+void SignatureScanner::ScanRange(const Range& range, const vector<int>& patternIds)
+{
+    // Bucket the patterns by the value of their anchor byte. Each position in the range then only needs a single
+    // lookup to find the patterns that could match around it, however many patterns there are.
+    array<vector<int>, 256> patternsByAnchor;
+    vector<BYTE> anchorValues;
+    int numRemaining = 0;
+    for (int patternId : patternIds)
+    {
+        Pattern& pattern = Patterns[patternId];
+        if (pattern.AnchorOffset < 0)
+        {
+            // Nothing to dispatch on, but this is only the case for patterns that are almost entirely masked out
+            pattern.pMatch = MemoryUtil::FindData(range.Start, range.Size, pattern.Bytes.data(), pattern.Mask.data(), pattern.Bytes.size());
+            continue;
+        }
+
+        BYTE anchorValue = pattern.Bytes[pattern.AnchorOffset];
+        if (patternsByAnchor[anchorValue].empty())
+            anchorValues.push_back(anchorValue);
+
+        patternsByAnchor[anchorValue].push_back(patternId);
+        numRemaining++;
+    }
+
+    BYTE* pRangeStart = range.Start;
+    BYTE* pRangeEnd = range.Start + range.Size;
+    auto checkAnchor = [&](BYTE* pAnchor)
+    {
+        for (int patternId : patternsByAnchor[*pAnchor])
+        {
+            Pattern& pattern = Patterns[patternId];
+            if (pattern.pMatch != nullptr)
+                continue;
+
+            BYTE* pTest = pAnchor - pattern.AnchorOffset;
+            if (pTest < pRangeStart || pTest + pattern.Bytes.size() > pRangeEnd || !MatchesAt(pTest, pattern))
+                continue;
+
+            pattern.pMatch = pTest;
+            numRemaining--;
+        }
+    };
+
+    int position = 0;
+#if SIGNATURESCANNER_SSE2
+    // Compare 16 positions at a time against every anchor value; beyond a handful of them, the table lookup is faster
+    static constexpr int MaxVectorAnchors = 8;
+    if (anchorValues.size() <= MaxVectorAnchors)
+    {
+        __m128i anchorVectors[MaxVectorAnchors];
+        for (int i = 0; i < anchorValues.size(); i++)
+        {
+            anchorVectors[i] = _mm_set1_epi8((char)anchorValues[i]);
+        }
+
+        for (; position + 16 <= range.Size && numRemaining > 0; position += 16)
+        {
+            __m128i bytes = _mm_loadu_si128((const __m128i*)(pRangeStart + position));
+            __m128i matches = _mm_setzero_si128();
+            for (int i = 0; i < anchorValues.size(); i++)
+            {
+                matches = _mm_or_si128(matches, _mm_cmpeq_epi8(bytes, anchorVectors[i]));
+            }
+
+            unsigned int candidates = (unsigned int)_mm_movemask_epi8(matches);
+            for (; candidates != 0; candidates &= candidates - 1)
+            {
+                checkAnchor(pRangeStart + position + countr_zero(candidates));
+            }
+        }
+    }
+#endif
+    for (; position < range.Size && numRemaining > 0; position++)
+    {
+        if (!patternsByAnchor[pRangeStart[position]].empty())
+            checkAnchor(pRangeStart + position);
+    }
+}
+
+void SignatureScanner::SearchPattern(int patternId)
+{
+    Pattern& pattern = Patterns[patternId];
+    pattern.Searched = true;
+    vector<Range> ranges = GetRanges();
+    if (TryGetCachedMatch(pattern, ranges))
+        return;
+
+    for (const Range& range : ranges)
+    {
+        if (!IsInRegion(range, pattern.Region))
+            continue;
+
+        if (pattern.Mask.empty())
+            pattern.pMatch = MemoryUtil::FindData(range.Start, range.Size, pattern.Bytes.data(), pattern.Bytes.size());
+        else
+            pattern.pMatch = MemoryUtil::FindData(range.Start, range.Size, pattern.Bytes.data(), pattern.Mask.data(), pattern.Bytes.size());
+
+        if (pattern.pMatch != nullptr)
+            break;
+    }
+
+    SignatureCache::Set(pattern.CacheKey, pattern.pMatch);
+    SignatureCache::Flush();
+}
+
+bool SignatureScanner::TryGetCachedMatch(Pattern& pattern, const vector<Range>& ranges)
+{
+    void* pMatch;
+    if (!SignatureCache::TryGet(pattern.CacheKey, pMatch))
+        return false;
+
+    // The cache is only invalidated when the executable's timestamp, checksum or size changes, and a hex-patched
+    // executable usually keeps all three. A miss can't be verified without searching again, so those always get
+    // searched (together with the other uncached patterns in Scan()). Since callers write to the matches, make
+    // sure the pattern is still at a cached address.
+    if (pMatch == nullptr)
+        return false;
+
+    for (const Range& range : ranges)
+    {
+        BYTE* pTest = (BYTE*)pMatch;
+        if (!IsInRegion(range, pattern.Region) || pTest < range.Start || pTest - range.Start > range.Size - (int)pattern.Bytes.size())
+            continue;
+
+        if (!MatchesAt(pTest, pattern))
+            break;
+
+        pattern.pMatch = pMatch;
+        return true;
+    }
+    return false;
+}
+
+bool SignatureScanner::MatchesAt(const BYTE* pTest, const Pattern& pattern)
+{
+    if (pattern.Mask.empty())
+        return memcmp(pTest, pattern.Bytes.data(), pattern.Bytes.size()) == 0;
+
+    for (int i = 0; i < pattern.Bytes.size(); i++)
+    {
+        if ((pTest[i] & pattern.Mask[i]) != pattern.Bytes[i])
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+enum class SignatureRegion
+{
+    Image,          // Headers and all sections
+    Headers,
+    Code,           // Sections marked as containing code
+    Data            // All other sections
+};
+
+// Finds the byte patterns that the various subsystems look for in the game executable. Patterns that are added
+// before Scan() get resolved together in a single pass over each section, rather than each of them scanning the
+// image separately. Patterns that are added afterwards are searched for on their own the first time they're requested.
+// Matches are kept in the SignatureCache, so as long as the executable doesn't change, later launches only check
+// that they're still there. Patterns that weren't found are searched for again on every launch.
+class SignatureScanner
+{
+public:
+    static int                  AddPattern          (SignatureRegion region, const void* pPattern, int length);
+    static int                  AddPattern          (SignatureRegion region, const void* pPattern, const void* pMask, int length);
+
+    static void                 Scan                ();
+
+    // Returns the address of the first occurrence of the pattern, or nullptr if it doesn't occur.
+    static void*                GetMatch            (int patternId);
+
+private:
+    struct Pattern
+    {
+        SignatureRegion         Region;
+        std::vector<BYTE>       Bytes;
+        std::vector<BYTE>       Mask;           // Empty for exact patterns
+        int                     AnchorOffset;   // Offset of the unmasked byte that the scan dispatches on, or -1 if there's none
+        bool                    Searched;
+        void*                   pMatch;
+        std::string             CacheKey;
+    };
+
+    struct Range
+    {
+        BYTE*                   Start;
+        int                     Size;
+        bool                    IsHeaders;
+        bool                    IsCode;
+    };
+
+    static std::string          GetCacheKey         (const Pattern& pattern);
+    static std::vector<Range>   GetRanges           ();
+    static bool                 IsInRegion          (const Range& range, SignatureRegion region);
+    static void                 ScanRange           (const Range& range, const std::vector<int>& patternIds);
+    static void                 SearchPattern       (int patternId);
+    static bool                 TryGetCachedMatch   (Pattern& pattern, const std::vector<Range>& ranges);
+    static bool                 MatchesAt           (const BYTE* pTest, const Pattern& pattern);
+
+    static inline std::vector<Pattern> Patterns{};
+    static inline bool Scanned{};
+};
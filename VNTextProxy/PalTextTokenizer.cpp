@@ -0,0 +1,73 @@
+#include "pch.h"
+
+using namespace std;
+
+const PalTextTokenizer::TagDefinition PalTextTokenizer::Tags[] =
+{
+    { "i",              StyleProperty::Italic,      true },
+    { "/i",             StyleProperty::Italic,      false },
+    { "b",              StyleProperty::Bold,        true },
+    { "/b",             StyleProperty::Bold,        false },
+    { "monospace",      StyleProperty::Monospace,   true },
+    { "/monospace",     StyleProperty::Monospace,   false }
+};
+
+int PalTextTokenizer::Tokenize(const unsigned char* pText, vector<Token>& tokens)
+{
+    tokens.clear();
+
+    // '<' and '>' can be the trail byte of a tunnel character, so the text is walked a character at a time
+    const unsigned char* pPos = pText;
+    while (*pPos != '\0')
+    {
+        Token token = {};
+        token.Offset = pPos - pText;
+        if (*pPos == '<')
+        {
+            const unsigned char* pPrevPos;
+            do
+            {
+                pPrevPos = pPos;
+                pPos = NextChar(pPos);
+            } while (*pPrevPos != '>' && *pPos != '\0');
+
+            token.Type = TokenType::ControlCode;
+            token.Length = (pPos - pText) - token.Offset;
+            if (*pPrevPos == '>')
+                LookUpTag(pText + token.Offset + 1, token.Length - 2, token);
+        }
+        else
+        {
+            do
+            {
+                pPos = NextChar(pPos);
+            } while (*pPos != '<' && *pPos != '\0');
+
+            token.Type = TokenType::Text;
+            token.Length = (pPos - pText) - token.Offset;
+        }
+        tokens.push_back(token);
+    }
+    return pPos - pText;
+}
+
+const unsigned char* PalTextTokenizer::NextChar(const unsigned char* p)
+{
+    if (Cp932::IsLeadByte(*p) && p[1] != '\0')
+        return p + 2;
+
+    return p + 1;
+}
+
+void PalTextTokenizer::LookUpTag(const unsigned char* pName, int length, Token& token)
+{
+    for (const TagDefinition& tag : Tags)
+    {
+        if (strlen(tag.Name) == length && memcmp(tag.Name, pName, length) == 0)
+        {
+            token.Property = tag.Property;
+            token.Value = tag.Value;
+            return;
+        }
+    }
+}
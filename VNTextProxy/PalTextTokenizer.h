@@ -0,0 +1,46 @@
+#pragma once
+
+// Splits PAL text into runs of characters and the control codes (<i>, </b>, ...) between them
+class PalTextTokenizer
+{
+public:
+    enum class TokenType
+    {
+        Text,
+        ControlCode
+    };
+
+    // What a control code changes. Supporting a new tag means adding a property here and a row to Tags.
+    enum class StyleProperty
+    {
+        None,               // Tag that isn't known; skipped without effect
+        Bold,
+        Italic,
+        Monospace
+    };
+
+    struct Token
+    {
+        TokenType Type;
+        int Offset;         // In bytes, from the start of the text
+        int Length;
+        StyleProperty Property;
+        int Value;
+    };
+
+    // Tokenizes the '\0'-terminated text into tokens (replacing its contents) and returns the length of the text in bytes
+    static int Tokenize(const unsigned char* pText, std::vector<Token>& tokens);
+
+private:
+    struct TagDefinition
+    {
+        const char* Name;
+        StyleProperty Property;
+        int Value;
+    };
+
+    static const unsigned char* NextChar(const unsigned char* p);
+    static void LookUpTag(const unsigned char* pName, int length, Token& token);
+
+    static const TagDefinition Tags[];
+};
@@ -0,0 +1,210 @@
+#include "pch.h"
+#include "ShaderCache.h"
+#include "Util/Logger.h"
+#include <d3dcompiler.h>
+#include <fstream>
+
+#pragma comment(lib, "d3dcompiler.lib")
+#pragma comment(lib, "version.lib")
+
+#define shader_log(...) proxy_log(LogCategory::SHADER, __VA_ARGS__)
+
+using namespace std;
+
+namespace ShaderCache
+{
+    static constexpr const wchar_t* CacheFolderName = L"VNTranslationToolsShaderCache";
+    static constexpr UINT CompileFlags = D3DCOMPILE_OPTIMIZATION_LEVEL3;
+    static constexpr DWORD FileMagic = 0x43534E56;     // "VNSC"
+    static constexpr DWORD FileVersion = 1;
+
+    struct FileHeader
+    {
+        DWORD Magic;
+        DWORD Version;
+        unsigned long long Key;
+        unsigned long long BytecodeHash;
+        DWORD BytecodeSize;
+    };
+
+    static unsigned long long AddToHash(unsigned long long hash, const void* pData, size_t size)
+    {
+        // FNV-1a
+        const BYTE* pBytes = (const BYTE*)pData;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ pBytes[i]) * 0x100000001B3ull;
+        }
+        return hash;
+    }
+
+    // Shaders compiled with fxc during the build. ShaderGen writes out their sources and generates EmbeddedShaders.h;
+    // the source hash makes sure the bytecode still belongs to the source we're asked to compile.
+    struct EmbeddedShader
+    {
+        const char* pName;
+        const char* pEntryPoint;
+        const char* pTarget;
+        unsigned long long SourceHash;
+        const BYTE* pBytecode;
+        size_t BytecodeSize;
+    };
+
+#include "EmbeddedShaders.h"
+
+    static bool TryGetEmbedded(const string& source, const char* pName, const char* pEntryPoint, const char* pTarget, vector<BYTE>& bytecode)
+    {
+        for (const EmbeddedShader& shader : EmbeddedShaders)
+        {
+            if (strcmp(shader.pName, pName) != 0 || strcmp(shader.pEntryPoint, pEntryPoint) != 0 || strcmp(shader.pTarget, pTarget) != 0)
+                continue;
+
+            if (shader.SourceHash != AddToHash(0xCBF29CE484222325ull, source.c_str(), source.size() + 1))
+            {
+                shader_log("ShaderCache: embedded %s/%s was built from a different source, ignoring it", pName, pEntryPoint);
+                return false;
+            }
+
+            bytecode.assign(shader.pBytecode, shader.pBytecode + shader.BytecodeSize);
+            return true;
+        }
+        return false;
+    }
+
+    // D3D_COMPILER_VERSION is only the 47 in the DLL name. What actually changes the output is the build of
+    // d3dcompiler_47.dll that was loaded, which differs between Windows versions and redistributables.
+    static unsigned long long GetCompilerFileVersion()
+    {
+        static const unsigned long long version = []
+        {
+            HMODULE hCompiler = GetModuleHandleW(D3DCOMPILER_DLL_W);
+            wchar_t path[MAX_PATH];
+            if (!hCompiler || !GetModuleFileNameW(hCompiler, path, MAX_PATH))
+                return 0ull;
+
+            DWORD size = GetFileVersionInfoSizeW(path, nullptr);
+            vector<BYTE> versionInfo(size);
+            VS_FIXEDFILEINFO* pFileInfo = nullptr;
+            UINT fileInfoSize = 0;
+            if (size == 0 || !GetFileVersionInfoW(path, 0, size, versionInfo.data()) ||
+                !VerQueryValueW(versionInfo.data(), L"\\", (void**)&pFileInfo, &fileInfoSize) || fileInfoSize < sizeof(VS_FIXEDFILEINFO))
+            {
+                return 0ull;
+            }
+
+            shader_log("ShaderCache: %ls version %u.%u.%u.%u", D3DCOMPILER_DLL_W,
+                HIWORD(pFileInfo->dwFileVersionMS), LOWORD(pFileInfo->dwFileVersionMS),
+                HIWORD(pFileInfo->dwFileVersionLS), LOWORD(pFileInfo->dwFileVersionLS));
+            return ((unsigned long long)pFileInfo->dwFileVersionMS << 32) | pFileInfo->dwFileVersionLS;
+        }();
+        return version;
+    }
+
+    static unsigned long long GetKey(const string& source, const char* pEntryPoint, const char* pTarget)
+    {
+        unsigned long long hash = 0xCBF29CE484222325ull;
+        hash = AddToHash(hash, source.c_str(), source.size() + 1);
+        hash = AddToHash(hash, pEntryPoint, strlen(pEntryPoint) + 1);
+        hash = AddToHash(hash, pTarget, strlen(pTarget) + 1);
+
+        UINT flags = CompileFlags;
+        unsigned long long compilerVersion = GetCompilerFileVersion();
+        hash = AddToHash(hash, &flags, sizeof(flags));
+        hash = AddToHash(hash, &compilerVersion, sizeof(compilerVersion));
+        return hash;
+    }
+
+    static wstring GetFilePath(unsigned long long key)
+    {
+        wchar_t fileName[32];
+        swprintf_s(fileName, L"%016llX.cso", key);
+        return Path::Combine(CacheFolderName, fileName);
+    }
+
+    static bool TryLoad(unsigned long long key, vector<BYTE>& bytecode)
+    {
+        ifstream file(GetFilePath(key), ios::binary);
+        if (!file.is_open())
+            return false;
+
+        // Entries that are truncated or otherwise damaged are simply compiled and written again
+        FileHeader header{};
+        if (!file.read((char*)&header, sizeof(header)) ||
+            header.Magic != FileMagic || header.Version != FileVersion || header.Key != key || header.BytecodeSize == 0)
+        {
+            return false;
+        }
+
+        bytecode.resize(header.BytecodeSize);
+        if (!file.read((char*)bytecode.data(), bytecode.size()) ||
+            AddToHash(0xCBF29CE484222325ull, bytecode.data(), bytecode.size()) != header.BytecodeHash)
+        {
+            bytecode.clear();
+            return false;
+        }
+        return true;
+    }
+
+    static void Store(unsigned long long key, const vector<BYTE>& bytecode)
+    {
+        CreateDirectoryW(CacheFolderName, nullptr);
+
+        ofstream file(GetFilePath(key), ios::binary | ios::trunc);
+        if (!file.is_open())
+        {
+            shader_log("ShaderCache: can't write to %ls, shaders will be compiled on every launch", CacheFolderName);
+            return;
+        }
+
+        FileHeader header{};
+        header.Magic = FileMagic;
+        header.Version = FileVersion;
+        header.Key = key;
+        header.BytecodeHash = AddToHash(0xCBF29CE484222325ull, bytecode.data(), bytecode.size());
+        header.BytecodeSize = (DWORD)bytecode.size();
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)bytecode.data(), bytecode.size());
+    }
+
+    vector<BYTE> Compile(const string& source, const char* pName, const char* pEntryPoint, const char* pTarget)
+    {
+        vector<BYTE> bytecode;
+        if (TryGetEmbedded(source, pName, pEntryPoint, pTarget, bytecode))
+        {
+            shader_log("ShaderCache: using embedded %s/%s (%zu bytes)", pName, pEntryPoint, bytecode.size());
+            return bytecode;
+        }
+
+        unsigned long long key = GetKey(source, pEntryPoint, pTarget);
+        if (TryLoad(key, bytecode))
+        {
+            shader_log("ShaderCache: loaded %s/%s from cache (%zu bytes)", pName, pEntryPoint, bytecode.size());
+            return bytecode;
+        }
+
+        shader_log("ShaderCache: compiling %s/%s (%zu bytes of source)", pName, pEntryPoint, source.length());
+        ID3DBlob* pBlob = nullptr;
+        ID3DBlob* pErrorBlob = nullptr;
+        HRESULT hr = D3DCompile(source.c_str(), source.length(), pName, nullptr, nullptr,
+            pEntryPoint, pTarget, CompileFlags, 0, &pBlob, &pErrorBlob);
+        if (pErrorBlob)
+        {
+            if (FAILED(hr))
+                shader_log("ShaderCache: shader error in %s/%s:\n%s", pName, pEntryPoint, (char*)pErrorBlob->GetBufferPointer());
+
+            pErrorBlob->Release();
+        }
+        if (FAILED(hr))
+        {
+            shader_log("ShaderCache: FAILED to compile %s/%s (hr=0x%08X)", pName, pEntryPoint, hr);
+            return bytecode;
+        }
+
+        const BYTE* pBytecode = (const BYTE*)pBlob->GetBufferPointer();
+        bytecode.assign(pBytecode, pBytecode + pBlob->GetBufferSize());
+        pBlob->Release();
+
+        Store(key, bytecode);
+        return bytecode;
+    }
+}
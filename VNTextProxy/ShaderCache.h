@@ -0,0 +1,14 @@
+#pragma once
+
+// Provides the bytecode for the proxy's shaders. Normally it was compiled with fxc during the build and is embedded
+// in the DLL (see ShaderGen). Shaders that aren't embedded, or whose source no longer matches, are compiled with
+// D3DCompile, and the bytecode is kept in the VNTranslationToolsShaderCache folder next to the runtime config so that
+// later launches don't have to run the compiler again. Entries are named after a hash of everything that goes into
+// the compilation (source, entry point, target, flags and the file version of the loaded d3dcompiler_47.dll), so an
+// edited shader or an updated compiler simply ends up in a new entry.
+namespace ShaderCache
+{
+    // Returns the bytecode of the shader, compiling it if it's neither embedded nor cached yet.
+    // Returns an empty vector (and logs the compiler errors) if the shader doesn't compile.
+    std::vector<BYTE> Compile(const std::string& source, const char* pName, const char* pEntryPoint, const char* pTarget);
+}
@@ -0,0 +1,142 @@
+// Writes out the HLSL that VNTextProxy passes to ShaderCache::Compile(), so the build can compile it with fxc and embed
+// the bytecode in the DLL (see the EmbeddedShader items in VNTextProxy.vcxproj). The sources come from the same code
+// the proxy uses at runtime, so they can't get out of sync with it.
+// Doesn't use any Win32 functions so it can be built and checked outside of Windows as well.
+//
+// Usage: ShaderGen <output folder> <name>:<entry point>:<target>...
+// Writes <name>_<entry point>.hlsl for every shader, and EmbeddedShaders.h, which includes the headers that fxc makes
+// of them (<name>_<entry point>.h, with the bytecode in g_<name>_<entry point>) and lists them for ShaderCache.
+// Files are only rewritten if their contents changed.
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CuNNyShaderSource.h"
+#include "DX11Shaders.h"
+
+using namespace std;
+
+struct ShaderSpec
+{
+    string Name;
+    string EntryPoint;
+    string Target;
+};
+
+// The names VNTextProxy compiles its shaders under
+static string GetShaderSource(const string& name)
+{
+    for (int pass = 1; pass <= CuNNyShaderSource::NumPasses; pass++)
+    {
+        if (name == "Pass" + to_string(pass))
+            return CuNNyShaderSource::BuildPass(pass);
+    }
+
+    if (name == "Downscale")
+        return CuNNyShaderSource::BuildDownscale();
+
+    if (name == "DownscaleVS")
+        return CuNNyShaderSource::BuildDownscaleVertexShader();
+
+    if (name == "BicubicScaler")
+        return g_BicubicShader;
+
+    return "";
+}
+
+// Must match the source hash in ShaderCache.cpp: FNV-1a over the source including its terminator
+static unsigned long long GetSourceHash(const string& source)
+{
+    unsigned long long hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i <= source.size(); i++)
+    {
+        hash = (hash ^ (unsigned char)source.c_str()[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+static bool WriteIfChanged(const string& path, const string& contents)
+{
+    ifstream existingFile(path, ios::binary);
+    if (existingFile.is_open() && string(istreambuf_iterator<char>(existingFile), istreambuf_iterator<char>()) == contents)
+        return true;
+
+    existingFile.close();
+    ofstream file(path, ios::binary | ios::trunc);
+    if (!file.is_open() || !file.write(contents.data(), contents.size()))
+    {
+        fprintf(stderr, "ShaderGen: can't write %s\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+static bool ParseSpec(const string& arg, ShaderSpec& spec)
+{
+    size_t entryPointPos = arg.find(':');
+    size_t targetPos = entryPointPos == string::npos ? string::npos : arg.find(':', entryPointPos + 1);
+    if (targetPos == string::npos)
+        return false;
+
+    spec.Name = arg.substr(0, entryPointPos);
+    spec.EntryPoint = arg.substr(entryPointPos + 1, targetPos - entryPointPos - 1);
+    spec.Target = arg.substr(targetPos + 1);
+    return !spec.Name.empty() && !spec.EntryPoint.empty() && !spec.Target.empty();
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: ShaderGen <output folder> <name>:<entry point>:<target>...\n");
+        return 1;
+    }
+
+    string outputFolder = argv[1];
+    if (outputFolder.back() != '/' && outputFolder.back() != '\\')
+        outputFolder += '/';
+
+    ostringstream includes;
+    ostringstream table;
+    for (int i = 2; i < argc; i++)
+    {
+        ShaderSpec spec;
+        if (!ParseSpec(argv[i], spec))
+        {
+            fprintf(stderr, "ShaderGen: invalid shader \"%s\", expected <name>:<entry point>:<target>\n", argv[i]);
+            return 1;
+        }
+
+        string source = GetShaderSource(spec.Name);
+        if (source.empty())
+        {
+            fprintf(stderr, "ShaderGen: no source for shader %s (or the embedded shader doesn't have the expected layout)\n", spec.Name.c_str());
+            return 1;
+        }
+
+        string baseName = spec.Name + "_" + spec.EntryPoint;
+        if (!WriteIfChanged(outputFolder + baseName + ".hlsl", source))
+            return 1;
+
+        char hash[32];
+        snprintf(hash, sizeof(hash), "0x%016llXull", GetSourceHash(source));
+        includes << "#include \"" << baseName << ".h\"\n";
+        table << "    { \"" << spec.Name << "\", \"" << spec.EntryPoint << "\", \"" << spec.Target << "\", " << hash << ", "
+              << "g_" << baseName << ", sizeof(g_" << baseName << ") },\n";
+    }
+
+    string header =
+        "// Generated by ShaderGen from the shader sources of VNTextProxy; see VNTextProxy.vcxproj\n"
+        "#pragma once\n"
+        "\n" +
+        includes.str() +
+        "\n"
+        "static const EmbeddedShader EmbeddedShaders[] =\n"
+        "{\n" +
+        table.str() +
+        "};\n";
+    return WriteIfChanged(outputFolder + "EmbeddedShaders.h", header) ? 0 : 1;
+}
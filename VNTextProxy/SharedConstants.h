@@ -13,7 +13,8 @@
 #define GAME_DEFAULT_SPACING_BETWEEN_LINES 8
 #define GAME_DEFAULT_MAX_LINE_WIDTH 528
 
-// SJIS tunnelling doesn't work in softpal, so plumb special characters in ASCII and half-width katakana
+// Special characters plumbed through ASCII and half-width katakana. This predates tunnel characters being decoded by
+// SjisTunnelEncoding::Decode() (which GetGlyphOutlineA goes through) and is kept so existing patches keep rendering.
 #define MAP_SPACE_CHARACTER '|'
 #define MAP_SJIS_1 'ｱ'
 #define MAP_UNICODE_1 u'%'
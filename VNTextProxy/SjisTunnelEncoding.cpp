@@ -1,42 +1,19 @@
 #include "pch.h"
+#include "Util/Logger.h"
 
 using namespace std;
 
 wstring SjisTunnelEncoding::Decode(const char* pText, int count)
 {
-    Init();
-
     wstring result;
     if (pText == nullptr)
         return result;
 
-    int i = 0;
-    while (count < 0 ? pText[i] != '\0' : i < count)
-    {
-        BYTE highByte = pText[i++];
-        BYTE lowByte = 0;
-
-        if (IsSjisHighByte(highByte))
-        {
-            lowByte = pText[i++];
-            if (lowByte == 0)
-                break;
-
-#if 0
-            int mappingIdx = TunnelCharToMappingIndex((WORD)((highByte << 8) | lowByte));
-            if (mappingIdx >= 0)
-            {
-                result += Mappings[mappingIdx];
-                continue;
-            }
-#endif
-        }
+    if (count < 0)
+        count = strlen(pText);
 
-        int charLength = lowByte == 0 ? 1 : 2;
-        wchar_t wc;
-        MultiByteToWideChar(932, 0, pText + i - charLength, charLength, &wc, 1);
-        result += wc;
-    }
+    result.resize(count);
+    result.resize(Decode(pText, count, result.data(), result.size()));
     return result;
 }
 
@@ -45,50 +22,151 @@ wstring SjisTunnelEncoding::Decode(const string& str)
     return Decode(str.c_str());
 }
 
-string SjisTunnelEncoding::Encode(const wchar_t* pText, int count)
+int SjisTunnelEncoding::Decode(const char* pText, int count, wchar_t* pOutput, int outputSize)
 {
     Init();
 
+    if (pText == nullptr)
+        return 0;
+
+    bool nullTerminated = count < 0;
+    if (nullTerminated)
+        count = strlen(pText);
+
+    int numBytesRead;
+    int numChars = Cp932::Decode(pText, count, pOutput, outputSize, numBytesRead, DecodeTunnelChar);
+    if (numBytesRead < count)
+        numChars += Cp932::GetDecodedLength(pText + numBytesRead, count - numBytesRead);
+
+    if (nullTerminated)
+    {
+        if (numChars < outputSize)
+            pOutput[numChars] = L'\0';
+
+        numChars++;
+    }
+    return numChars;
+}
+
+int SjisTunnelEncoding::GetDecodedLength(const char* pText, int count)
+{
+    if (pText == nullptr)
+        return 0;
+
+    if (count < 0)
+        return Cp932::GetDecodedLength(pText, strlen(pText)) + 1;
+
+    return Cp932::GetDecodedLength(pText, count);
+}
+
+string SjisTunnelEncoding::Encode(const wchar_t* pText, int count)
+{
     string result;
     if (pText == nullptr)
         return result;
 
-    int i = 0;
-    while (count < 0 ? pText[i] != L'\0' : i < count)
+    if (count < 0)
+        count = wcslen(pText);
+
+    result.resize(count * 2);
+    result.resize(Encode(pText, count, result.data(), result.size()));
+    return result;
+}
+
+string SjisTunnelEncoding::Encode(const wstring& str)
+{
+    return Encode(str.c_str());
+}
+
+int SjisTunnelEncoding::Encode(const wchar_t* pText, int count, char* pOutput, int outputSize)
+{
+    Init();
+
+    if (pText == nullptr)
+        return 0;
+
+    bool nullTerminated = count < 0;
+    if (nullTerminated)
+        count = wcslen(pText);
+
+    int length = 0;
+    for (int i = 0; i < count; i++)
     {
-        wchar_t widechar = pText[i++];
         char multibyte[2];
-        BOOL failed;
-        int multibyteLength = WideCharToMultiByte(932, WC_NO_BEST_FIT_CHARS, &widechar, 1, multibyte, sizeof(multibyte), nullptr, &failed);
-        if (failed || multibyte[0] >= 0xF0)
+        int multibyteLength = EncodeChar(pText[i], multibyte);
+        if (length + multibyteLength <= outputSize)
+            memcpy(pOutput + length, multibyte, multibyteLength);
+
+        length += multibyteLength;
+    }
+
+    if (nullTerminated)
+    {
+        if (length < outputSize)
+            pOutput[length] = '\0';
+
+        length++;
+    }
+    return length;
+}
+
+int SjisTunnelEncoding::GetEncodedLength(const wchar_t* pText, int count)
+{
+    Init();
+
+    if (pText == nullptr)
+        return 0;
+
+    bool nullTerminated = count < 0;
+    if (nullTerminated)
+        count = wcslen(pText);
+
+    // Unlike Encode(), this doesn't need to assign tunnel slots: a character that can't be converted
+    // always takes two bytes, whichever slot it ends up getting.
+    int length = 0;
+    for (int i = 0; i < count; i++)
+    {
+        wchar_t widechar = pText[i];
+        if (FindMapping(widechar) >= 0)
         {
-            auto it = find(Mappings.begin(), Mappings.end(), widechar);
-            int mappingIdx;
-            if (it == Mappings.end())
-            {
-                Mappings.push_back(widechar);
-                mappingIdx = Mappings.size() - 1;
-                if (mappingIdx == 0x3B * (0x40 - sizeof(LowBytesToAvoid) - 1))
-                    throw exception("SJIS tunnel limit exceeded");
-            }
-            else
-            {
-                mappingIdx = distance(Mappings.begin(), it);
-            }
-
-            WORD tunnelChar = MappingIndexToTunnelChar(mappingIdx);
-            multibyte[0] = (char)(tunnelChar >> 8);
-            multibyte[1] = (char)(tunnelChar);
-            multibyteLength = 2;
+            length += 2;
+            continue;
         }
-        result.append(multibyte, multibyteLength);
+
+        char multibyte[2];
+        BOOL failed;
+        int multibyteLength = WideCharToMultiByte(932, WC_NO_BEST_FIT_CHARS, &widechar, 1, multibyte, sizeof(multibyte), nullptr, &failed);
+        length += failed ? 2 : multibyteLength;
     }
-    return result;
+
+    if (nullTerminated)
+        length++;
+
+    return length;
 }
 
-string SjisTunnelEncoding::Encode(const wstring& str)
+int SjisTunnelEncoding::EncodeChar(wchar_t widechar, char* pMultibyte)
 {
-    return Encode(str.c_str());
+    int mappingIdx = FindMapping(widechar);
+    if (mappingIdx < 0)
+    {
+        BOOL failed;
+        int multibyteLength = WideCharToMultiByte(932, WC_NO_BEST_FIT_CHARS, &widechar, 1, pMultibyte, 2, nullptr, &failed);
+        if (!failed && (BYTE)pMultibyte[0] < 0xF0)
+            return multibyteLength;
+
+        mappingIdx = AddMapping(widechar);
+    }
+
+    WORD tunnelChar = MappingIndexToTunnelChar(mappingIdx);
+    pMultibyte[0] = (char)(tunnelChar >> 8);
+    pMultibyte[1] = (char)(tunnelChar);
+    return 2;
+}
+
+void SjisTunnelEncoding::RegisterSignatures()
+{
+    LookupTableSignatureId = SignatureScanner::AddPattern(SignatureRegion::Image, LookupTableSearchPattern, sizeof(LookupTableSearchPattern));
 }
 
 void SjisTunnelEncoding::PatchGameLookupTable()
@@ -97,12 +175,14 @@ void SjisTunnelEncoding::PatchGameLookupTable()
     // rather than calling MultiByteToWideChar(). Find the table and patch it to support tunneling there as well.
 
     Init();
-    if (Mappings.empty())
+    int numMappings = GetNumMappings();
+    if (numMappings == 0)
         return;
 
-    void* pImageStart = GetModuleHandle(nullptr);
-    DWORD imageSize = DetourGetModuleSize(nullptr);
-    wchar_t* pLookupTable = (wchar_t*)MemoryUtil::FindData(pImageStart, imageSize, LookupTableSearchPattern, sizeof(LookupTableSearchPattern));
+    if (LookupTableSignatureId < 0)
+        RegisterSignatures();
+
+    wchar_t* pLookupTable = (wchar_t*)SignatureScanner::GetMatch(LookupTableSignatureId);
     if (pLookupTable == nullptr)
         return;
 
@@ -111,43 +191,211 @@ void SjisTunnelEncoding::PatchGameLookupTable()
     pLookupTable -= 0x8140;
 
     map<void*, MemoryUnprotector> unprotectors;
-    for (int mappingIdx = 0; mappingIdx < Mappings.size(); mappingIdx++)
+    for (int mappingIdx = 0; mappingIdx < numMappings; mappingIdx++)
     {
+        wchar_t c = GetMapping(mappingIdx);
+        if (c == L'\0')
+            continue;
+
         WORD tunnelChar = MappingIndexToTunnelChar(mappingIdx);
         wchar_t* pLookupEntry = &pLookupTable[tunnelChar];
 
-        void* pLookupEntryPage = (void*)((DWORD)pLookupEntry & ~0xFFF);
+        void* pLookupEntryPage = (void*)((uintptr_t)pLookupEntry & ~0xFFF);
         unprotectors.try_emplace(pLookupEntryPage, pLookupEntryPage, 0x1000);
 
-        *pLookupEntry = Mappings[mappingIdx];
+        *pLookupEntry = c;
     }
 }
 
 void SjisTunnelEncoding::Init()
 {
-    if (Initialized)
+    call_once(InitFlag, LoadMappings);
+}
+
+void SjisTunnelEncoding::LoadMappings()
+{
+    wstring filePath = Path::Combine(Path::GetModuleFolderPath(nullptr), L"sjis_ext.bin");
+    HANDLE hFile = CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
         return;
 
-    Initialized = true;
+    DWORD fileSize = GetFileSize(hFile, nullptr);
+    HANDLE hMapping = fileSize != 0 && fileSize != INVALID_FILE_SIZE ? CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    CloseHandle(hFile);
+    if (hMapping == nullptr)
+        return;
 
-    wstring filePath = Path::Combine(Path::GetModuleFolderPath(nullptr), L"sjis_ext.bin");
-    FILE* pFile;
-    _wfopen_s(&pFile, filePath.c_str(), L"rb");
+    // The view is never unmapped. Its pages are backed by the file itself, so nothing is copied at startup
+    // and they can be shared with any other process that has the file mapped.
+    const BYTE* pFile = (const BYTE*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(hMapping);
     if (pFile == nullptr)
         return;
 
-    fseek(pFile, 0, SEEK_END);
-    int fileSize = ftell(pFile);
-    fseek(pFile, 0, SEEK_SET);
-    Mappings.resize(fileSize / sizeof(wchar_t));
-    fread(Mappings.data(), sizeof(wchar_t), Mappings.size(), pFile);
-    fclose(pFile);
+    const MappingFileHeader* pHeader = (const MappingFileHeader*)pFile;
+    if (fileSize >= sizeof(MappingFileHeader) && pHeader->Magic == MappingFileMagic)
+    {
+        // Running without the mappings would garble every tunneled character in the game's text
+        if (!LoadMappingFile(pFile, fileSize))
+        {
+            proxy_log(LogCategory::TEXT, "sjis_ext.bin is corrupted or has an unsupported version (%u)", pHeader->Version);
+            MessageBoxW(nullptr, L"sjis_ext.bin is corrupted or was written by an unsupported version of VNTextPatch", L"Proxy", MB_ICONERROR);
+            ExitProcess(0);
+        }
+    }
+    else
+    {
+        LoadLegacyMappingFile(pFile, fileSize);
+    }
+}
+
+bool SjisTunnelEncoding::LoadMappingFile(const BYTE* pFile, DWORD fileSize)
+{
+    const MappingFileHeader* pHeader = (const MappingFileHeader*)pFile;
+    if (pHeader->Version != MappingFileVersion ||
+        pHeader->NumMappings > MaxMappings ||
+        pHeader->ReverseTableSize < 16 || pHeader->ReverseTableSize > 0x10000 ||
+        (pHeader->ReverseTableSize & (pHeader->ReverseTableSize - 1)) != 0 ||
+        pHeader->NumMappings >= pHeader->ReverseTableSize ||
+        (pHeader->ForwardTableOffset & 1) != 0 || (pHeader->ReverseTableOffset & 3) != 0 ||
+        pHeader->ForwardTableOffset < sizeof(MappingFileHeader) || pHeader->ReverseTableOffset < sizeof(MappingFileHeader) ||
+        pHeader->ForwardTableOffset > fileSize || fileSize - pHeader->ForwardTableOffset < pHeader->NumMappings * sizeof(WORD) ||
+        pHeader->ReverseTableOffset > fileSize || fileSize - pHeader->ReverseTableOffset < pHeader->ReverseTableSize * sizeof(MappingFileReverseEntry))
+    {
+        return false;
+    }
+
+    // FindFileMapping() trusts the reverse table, so check once that every entry points at its own character
+    const WORD* pMappings = (const WORD*)(pFile + pHeader->ForwardTableOffset);
+    const MappingFileReverseEntry* pReverseTable = (const MappingFileReverseEntry*)(pFile + pHeader->ReverseTableOffset);
+    for (DWORD entryIdx = 0; entryIdx < pHeader->ReverseTableSize; entryIdx++)
+    {
+        const MappingFileReverseEntry& entry = pReverseTable[entryIdx];
+        if (entry.MappingIndexPlusOne != 0 &&
+            (entry.MappingIndexPlusOne > pHeader->NumMappings || pMappings[entry.MappingIndexPlusOne - 1] != entry.Char))
+        {
+            return false;
+        }
+    }
+
+    int reverseTableBits = 0;
+    while ((1u << reverseTableBits) < pHeader->ReverseTableSize)
+    {
+        reverseTableBits++;
+    }
+
+    FileMappings = pMappings;
+    NumFileMappings = pHeader->NumMappings;
+    FileReverseTable = pReverseTable;
+    FileReverseTableBits = reverseTableBits;
+    NumMappings.store(NumFileMappings, memory_order_release);
+    return true;
+}
+
+void SjisTunnelEncoding::LoadLegacyMappingFile(const BYTE* pFile, DWORD fileSize)
+{
+    // The old format is just the forward table, so the reverse index has to be built here.
+    // Slots have to keep their position in the file even if it has duplicates, since that's what the tunnel chars were derived from.
+    // No other thread can see the table yet (they're all waiting in Init()), so there's no need for the AddMapping() dance.
+    int numMappings = min((int)(fileSize / sizeof(WORD)), MaxMappings);
+    FileMappings = (const WORD*)pFile;
+    NumFileMappings = numMappings;
+    for (int mappingIdx = 0; mappingIdx < numMappings; mappingIdx++)
+    {
+        wchar_t c = FileMappings[mappingIdx];
+        if (MappingIndices[c].load(memory_order_relaxed) == 0)
+            MappingIndices[c].store(mappingIdx + 1, memory_order_relaxed);
+    }
+    NumMappings.store(numMappings, memory_order_release);
+}
+
+int SjisTunnelEncoding::GetNumMappings()
+{
+    int numMappings = NumMappings.load(memory_order_acquire);
+    return numMappings < MaxMappings ? numMappings : MaxMappings;
+}
+
+wchar_t SjisTunnelEncoding::GetMapping(int mappingIdx)
+{
+    if (mappingIdx < NumFileMappings)
+        return (wchar_t)FileMappings[mappingIdx];
+
+    return Mappings[mappingIdx].load(memory_order_acquire);
+}
+
+int SjisTunnelEncoding::FindMapping(wchar_t c)
+{
+    if (FileReverseTable != nullptr)
+    {
+        int mappingIdx = FindFileMapping(c);
+        if (mappingIdx >= 0)
+            return mappingIdx;
+    }
+
+    WORD entry = MappingIndices[c].load(memory_order_acquire);
+    while (entry == PendingMappingIndex)
+    {
+        // Another thread is in the middle of adding this character; it only needs a few instructions to finish
+        YieldProcessor();
+        entry = MappingIndices[c].load(memory_order_acquire);
+    }
+    return entry - 1;
+}
+
+int SjisTunnelEncoding::FindFileMapping(wchar_t c)
+{
+    int mask = (1 << FileReverseTableBits) - 1;
+    int entryIdx = GetMappingTableHash(c, FileReverseTableBits);
+    for (int i = 0; i <= mask; i++)
+    {
+        const MappingFileReverseEntry& entry = FileReverseTable[entryIdx];
+        if (entry.MappingIndexPlusOne == 0)
+            return -1;
+
+        if (entry.Char == c)
+            return entry.MappingIndexPlusOne - 1;
+
+        entryIdx = (entryIdx + 1) & mask;
+    }
+    return -1;
+}
+
+int SjisTunnelEncoding::GetMappingTableHash(wchar_t c, int bits)
+{
+    // Must match SjisTunnelEncoding.GetMappingTableHash() in VNTextPatch, which builds the table
+    return (int)(((DWORD)c * 0x9E3779B1u) >> (32 - bits));
+}
+
+int SjisTunnelEncoding::AddMapping(wchar_t c)
+{
+    while (true)
+    {
+        int mappingIdx = FindMapping(c);
+        if (mappingIdx >= 0)
+            return mappingIdx;
+
+        // Claim the character first so that two threads encoding it at the same time can't both give it a slot
+        WORD expected = 0;
+        if (MappingIndices[c].compare_exchange_weak(expected, PendingMappingIndex, memory_order_acq_rel, memory_order_acquire))
+            break;
+    }
+
+    int mappingIdx = NumMappings.fetch_add(1, memory_order_acq_rel);
+    if (mappingIdx >= MaxMappings)
+    {
+        MappingIndices[c].store(0, memory_order_release);
+        throw runtime_error("SJIS tunnel limit exceeded");
+    }
+
+    Mappings[mappingIdx].store(c, memory_order_release);
+    MappingIndices[c].store(mappingIdx + 1, memory_order_release);
+    return mappingIdx;
 }
 
 WORD SjisTunnelEncoding::MappingIndexToTunnelChar(int index)
 {
-    int highIdx = index / (0x40 - sizeof(LowBytesToAvoid) - 1);
-    int lowIdx = index % (0x40 - sizeof(LowBytesToAvoid) - 1);
+    int highIdx = index / TunnelCharsPerRow;
+    int lowIdx = index % TunnelCharsPerRow;
     BYTE highByte = highIdx < 0x1F ? 0x81 + highIdx : 0xE0 + (highIdx - 0x1F);
     BYTE lowByte = 1 + lowIdx;
     for (int i = 0; i < sizeof(LowBytesToAvoid); i++)
@@ -162,24 +410,54 @@ WORD SjisTunnelEncoding::MappingIndexToTunnelChar(int index)
 int SjisTunnelEncoding::TunnelCharToMappingIndex(WORD tunnelChar)
 {
     BYTE highByte = (BYTE)(tunnelChar >> 8);
-    BYTE lowByte = (BYTE)tunnelChar;
-
-    if (!IsSjisHighByte(highByte) || lowByte == 0 || lowByte >= 0x40)
+    if (!IsSjisHighByte(highByte))
         return -1;
 
     int highIdx = highByte < 0xA0 ? highByte - 0x81 : 0x1F + (highByte - 0xE0);
+    return GetMappingIndex(highIdx, (BYTE)tunnelChar);
+}
+
+int SjisTunnelEncoding::GetMappingIndex(int highIdx, BYTE lowByte)
+{
+    if (lowByte >= TunnelLowByteIndices.size())
+        return -1;
 
-    int lowIdx = lowByte;
-    for (int i = sizeof(LowBytesToAvoid) - 1; i >= 0; i--)
+    BYTE lowIdx = TunnelLowByteIndices[lowByte];
+    if (lowIdx == NoTunnelLowByteIndex)
+        return -1;
+
+    return highIdx * TunnelCharsPerRow + lowIdx;
+}
+
+wchar_t SjisTunnelEncoding::DecodeTunnelChar(int leadByteRow, BYTE trailByte)
+{
+    // Tunnel high bytes are numbered in the same order as Cp932's lead byte rows, so the row can be used as is
+    int mappingIdx = GetMappingIndex(leadByteRow, trailByte);
+    if (mappingIdx < 0 || mappingIdx >= GetNumMappings())
+        return L'\0';
+
+    // Slots that are still being published read as '\0', which makes Cp932 fall back to its regular decoding
+    return GetMapping(mappingIdx);
+}
+
+constexpr array<BYTE, 0x40> SjisTunnelEncoding::BuildTunnelLowByteIndices()
+{
+    array<BYTE, 0x40> indices{};
+    int lowIdx = 0;
+    for (int lowByte = 0; lowByte < 0x40; lowByte++)
     {
-        if (lowIdx > LowBytesToAvoid[i])
-            lowIdx--;
+        bool avoided = lowByte == 0;
+        for (BYTE byteToAvoid : LowBytesToAvoid)
+        {
+            avoided |= lowByte == byteToAvoid;
+        }
+        indices[lowByte] = avoided ? NoTunnelLowByteIndex : lowIdx++;
     }
-    lowIdx--;
-    
-    return highIdx * (0x40 - sizeof(LowBytesToAvoid) - 1) + lowIdx;
+    return indices;
 }
 
+const array<BYTE, 0x40> SjisTunnelEncoding::TunnelLowByteIndices = BuildTunnelLowByteIndices();
+
 bool SjisTunnelEncoding::IsSjisHighByte(BYTE byte)
 {
     return (byte >= 0x81 && byte < 0xA0) || (byte >= 0xE0 && byte < 0xFD);
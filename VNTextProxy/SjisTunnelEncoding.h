@@ -9,19 +9,88 @@ public:
     static std::string Encode(const wchar_t* pText, int count = -1);
     static std::string Encode(const std::wstring& str);
 
+    // Conversions into a caller-provided buffer, with the same length semantics as MultiByteToWideChar()/WideCharToMultiByte():
+    // a negative count means the input is null-terminated and the terminator is included in the output. At most outputSize
+    // characters are written, and the return value is the length of the full result (so it's > outputSize if the buffer was too small).
+    static int Decode(const char* pText, int count, wchar_t* pOutput, int outputSize);
+    static int GetDecodedLength(const char* pText, int count);
+    static int Encode(const wchar_t* pText, int count, char* pOutput, int outputSize);
+    static int GetEncodedLength(const wchar_t* pText, int count);
+
+    static void RegisterSignatures();
     static void PatchGameLookupTable();
 
 private:
+    // sjis_ext.bin, as written by VNTextPatch. The fields and the hash have to stay in sync with SjisTunnelEncoding.cs.
+    // The reverse table is an open-addressing hash with linear probing; entries with a MappingIndexPlusOne of 0 are empty.
+    // Version 1 files have no header and consist of just the forward table. Characters are stored as UTF-16 code units.
+    struct MappingFileHeader
+    {
+        DWORD Magic;
+        DWORD Version;
+        DWORD NumMappings;
+        DWORD ReverseTableSize;
+        DWORD ForwardTableOffset;
+        DWORD ReverseTableOffset;
+    };
+
+    struct MappingFileReverseEntry
+    {
+        WORD Char;
+        WORD MappingIndexPlusOne;
+    };
+
+    static constexpr DWORD MappingFileMagic = 0x58454A53;      // "SJEX"
+    static constexpr DWORD MappingFileVersion = 2;
+
     static void Init();
+    static void LoadMappings();
+    static bool LoadMappingFile(const BYTE* pFile, DWORD fileSize);
+    static void LoadLegacyMappingFile(const BYTE* pFile, DWORD fileSize);
+    static int GetNumMappings();
+    static wchar_t GetMapping(int mappingIdx);
+    static int FindMapping(wchar_t c);
+    static int FindFileMapping(wchar_t c);
+    static int GetMappingTableHash(wchar_t c, int bits);
+    static int AddMapping(wchar_t c);
+    static int EncodeChar(wchar_t widechar, char* pMultibyte);
 
     static WORD MappingIndexToTunnelChar(int index);
     static int TunnelCharToMappingIndex(WORD tunnelChar);
+    static int GetMappingIndex(int highIdx, BYTE lowByte);
+    static wchar_t DecodeTunnelChar(int leadByteRow, BYTE trailByte);
     static bool IsSjisHighByte(BYTE byte);
 
-    static inline bool Initialized{};
-    static inline std::vector<wchar_t> Mappings{};
+    static constexpr BYTE LowBytesToAvoid[] = { '\t', '\n', '\r', ' ', ',' };
+    static constexpr int TunnelCharsPerRow = 0x40 - sizeof(LowBytesToAvoid) - 1;
+    static constexpr int MaxMappings = 0x3B * TunnelCharsPerRow;
+
+    // Position of each tunnel low byte within its row, or NoTunnelLowByteIndex for bytes that are never used
+    static constexpr BYTE NoTunnelLowByteIndex = 0xFF;
+    static constexpr std::array<BYTE, 0x40> BuildTunnelLowByteIndices();
+    static const std::array<BYTE, 0x40> TunnelLowByteIndices;
+
+    // The hooks that use this class run on the game thread, the DirectShow thread and in IME callbacks, so the mapping table is
+    // append-only and lock-free: AddMapping() reserves a slot through NumMappings and publishes it by storing the character.
+    // Slots that have been reserved but not yet published still read as '\0'.
+    static inline std::once_flag InitFlag{};
+
+    // Mappings loaded from sjis_ext.bin. The file stays mapped read-only and is used in place; only the mappings
+    // that get added at runtime (starting at index NumFileMappings) go into the atomic tables below.
+    static inline const WORD* FileMappings{};
+    static inline int NumFileMappings{};
+    static inline const MappingFileReverseEntry* FileReverseTable{};
+    static inline int FileReverseTableBits{};
+
+    static inline std::atomic<int> NumMappings{};
+    static inline std::atomic<wchar_t> Mappings[MaxMappings]{};
+
+    // Reverse lookup for Mappings: mapping index + 1 for each UTF-16 code unit, or 0 if it isn't tunneled.
+    // PendingMappingIndex marks a character that AddMapping() is currently assigning a slot to.
+    static constexpr WORD PendingMappingIndex = 0xFFFF;
+    static inline std::atomic<WORD> MappingIndices[0x10000]{};
 
-    static inline BYTE LowBytesToAvoid[] = { '\t', '\n', '\r', ' ', ',' };
+    static inline int LookupTableSignatureId = -1;
     static inline BYTE LookupTableSearchPattern[] = {
         0x00, 0x30, 0x01, 0x30, 0x02, 0x30, 0x0C, 0xFF, 0x0E, 0xFF, 0xFB, 0x30, 0x1A, 0xFF, 0x1B, 0xFF,
         0x1F, 0xFF, 0x01, 0xFF, 0x9B, 0x30, 0x9C, 0x30, 0xB4, 0x00, 0x40, 0xFF, 0xA8, 0x00, 0x3E, 0xFF
@@ -0,0 +1,124 @@
+// Decoding throughput over the strings of a SoftPal TEXT.DAT.
+// Usage: Cp932Benchmark [path to a decrypted TEXT.DAT, e.g. one written by VNTextPatch]
+// Without a path, a generated script of similar composition is used.
+#include <iconv.h>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include "../Util/Cp932.h"
+#include "TestUtil.h"
+
+using namespace std;
+
+// TEXT.DAT: a 16 byte header ("$TEXT_LIST__" + count), then an int32 and a null-terminated string per entry.
+// The first byte is '_' instead of '$' once the file has been decrypted.
+static vector<string> LoadTextDat(const char* pPath)
+{
+    ifstream file(pPath, ios::binary);
+    vector<char> data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    if (data.size() < 0x10 || memcmp(data.data() + 1, "TEXT_LIST__", 11) != 0)
+    {
+        fprintf(stderr, "%s is not a TEXT.DAT file\n", pPath);
+        exit(1);
+    }
+
+    if (data[0] == '$')
+        fprintf(stderr, "Warning: %s looks encrypted; the strings won't be representative\n", pPath);
+
+    vector<string> strings;
+    size_t offset = 0x10;
+    while (offset + 4 < data.size())
+    {
+        offset += 4;
+        size_t end = offset;
+        while (end < data.size() && data[end] != '\0')
+        {
+            end++;
+        }
+        strings.emplace_back(data.data() + offset, end - offset);
+        offset = end + 1;
+    }
+    return strings;
+}
+
+// Dialogue lines: mostly kana and kanji, with ASCII markup (<br>, names, numbers) mixed in
+static vector<string> GenerateScript()
+{
+    mt19937 random(1);
+    vector<string> strings;
+    for (int i = 0; i < 60000; i++)
+    {
+        string line;
+        int numRuns = 1 + random() % 8;
+        for (int run = 0; run < numRuns; run++)
+        {
+            if (random() % 4 == 0)
+            {
+                line += "<br>";
+                continue;
+            }
+
+            int length = 2 + random() % 12;
+            for (int j = 0; j < length; j++)
+            {
+                line += (char)(random() % 2 == 0 ? 0x82 : 0x88 + random() % 0x10);
+                line += (char)(0x9F + random() % 0x50);
+            }
+        }
+        strings.push_back(line);
+    }
+    return strings;
+}
+
+int main(int argc, char** argv)
+{
+    vector<string> strings = argc > 1 ? LoadTextDat(argv[1]) : GenerateScript();
+    size_t totalBytes = 0;
+    for (const string& str : strings)
+    {
+        totalBytes += str.size();
+    }
+    printf("%zu strings, %.2f MB\n", strings.size(), totalBytes / 1e6);
+
+    // What the proxy did before: one conversion call per character, appended to a growing string
+    iconv_t converter = iconv_open("WCHAR_T", "CP932");
+    double perCharMs = TestUtil::MeasureBest([&]
+    {
+        for (const string& str : strings)
+        {
+            wstring result;
+            size_t i = 0;
+            while (i < str.size())
+            {
+                size_t charLength = Cp932::IsLeadByte((unsigned char)str[i]) && i + 1 < str.size() ? 2 : 1;
+                char* pInput = const_cast<char*>(str.data() + i);
+                size_t inputLeft = charLength;
+                wchar_t c = L'\0';
+                char* pOutput = (char*)&c;
+                size_t outputLeft = sizeof(c);
+                iconv(converter, &pInput, &inputLeft, &pOutput, &outputLeft);
+                result += c;
+                i += charLength;
+            }
+            TestUtil::Consume(result.size());
+        }
+    });
+    iconv_close(converter);
+
+    vector<wchar_t> buffer;
+    double tableMs = TestUtil::MeasureBest([&]
+    {
+        for (const string& str : strings)
+        {
+            buffer.resize(str.size());
+            TestUtil::Consume(Cp932::Decode(str.data(), str.size(), buffer.data()));
+        }
+    });
+
+    printf("Per-character conversion: %8.2f ms (%7.1f MB/s)\n", perCharMs, totalBytes / 1e3 / perCharMs);
+    printf("Cp932::Decode:            %8.2f ms (%7.1f MB/s)\n", tableMs, totalBytes / 1e3 / tableMs);
+    return 0;
+}
@@ -0,0 +1,229 @@
+// Checks Cp932 against glibc's iconv CP932 converter, which matches MultiByteToWideChar(932, ...)
+// except for the single bytes listed in CheckSingleBytes().
+#include <iconv.h>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../Util/Cp932.h"
+#include "TestUtil.h"
+
+using namespace std;
+
+// Returns false if iconv rejects the input
+static bool IconvDecode(iconv_t converter, const string& input, vector<char16_t>& output)
+{
+    output.resize(input.size() + 1);
+    char* pInput = const_cast<char*>(input.data());
+    size_t inputLeft = input.size();
+    char* pOutput = (char*)output.data();
+    size_t outputLeft = output.size() * sizeof(char16_t);
+    iconv(converter, nullptr, nullptr, nullptr, nullptr);
+    if (iconv(converter, &pInput, &inputLeft, &pOutput, &outputLeft) == (size_t)-1)
+        return false;
+
+    output.resize(output.size() - outputLeft / sizeof(char16_t));
+    return true;
+}
+
+static void CheckSingleBytes(iconv_t converter)
+{
+    for (int byte = 0; byte < 0x100; byte++)
+    {
+        if (Cp932::IsLeadByte((unsigned char)byte))
+            continue;
+
+        // Windows maps these to themselves or the private use area, whereas iconv rejects them
+        wchar_t expected;
+        switch (byte)
+        {
+            case 0x80: expected = 0x0080; break;
+            case 0xA0: expected = 0xF8F0; break;
+            case 0xFD: expected = 0xF8F1; break;
+            case 0xFE: expected = 0xF8F2; break;
+            case 0xFF: expected = 0xF8F3; break;
+            default:
+            {
+                vector<char16_t> reference;
+                bool converted = IconvDecode(converter, string(1, (char)byte), reference);
+                CHECK(converted && reference.size() == 1);
+                expected = converted && reference.size() == 1 ? reference[0] : 0;
+                break;
+            }
+        }
+        CHECK_EQUAL(expected, Cp932::DecodeSingleByte((unsigned char)byte));
+
+        wchar_t decoded = 0;
+        char text = (char)byte;
+        CHECK_EQUAL(1, Cp932::Decode(&text, 1, &decoded));
+        CHECK_EQUAL(expected, decoded);
+    }
+}
+
+static void CheckDoubleBytes(iconv_t converter)
+{
+    int numInTrailRange = 0;
+    int numMapped = 0;
+    for (int leadByte = 0x81; leadByte < 0x100; leadByte++)
+    {
+        if (!Cp932::IsLeadByte((unsigned char)leadByte))
+            continue;
+
+        for (int trailByte = 0; trailByte < 0x100; trailByte++)
+        {
+            // Sequences that iconv rejects are the ones Windows replaces by its default char
+            string text = { (char)leadByte, (char)trailByte };
+            vector<char16_t> reference;
+            wchar_t expected = 0x30FB;
+            if (trailByte != 0 && IconvDecode(converter, text, reference) && reference.size() == 1)
+            {
+                expected = reference[0];
+                numMapped++;
+            }
+
+            wchar_t decoded = Cp932::DecodeDoubleByte((unsigned char)leadByte, (unsigned char)trailByte);
+            if (decoded != expected)
+                fprintf(stderr, "Mismatch for %02X%02X\n", leadByte, trailByte);
+
+            CHECK_EQUAL(expected, decoded);
+            if (trailByte >= Cp932::MinTrailByte && trailByte != 0x7F && trailByte < 0xFD)
+                numInTrailRange++;
+        }
+    }
+    printf("Compared %d double-byte codes in the trail byte range (%d of them mapped)\n", numInTrailRange, numMapped);
+}
+
+static void CheckIncompleteSequences()
+{
+    wchar_t output[8];
+    int numBytesRead;
+
+    // A lead byte at the end of the input is left for the caller (it may be continued in the next buffer)
+    CHECK_EQUAL(2, Cp932::Decode("ab\x82", 3, output, 8, numBytesRead));
+    CHECK_EQUAL(2, numBytesRead);
+    CHECK_EQUAL(2, Cp932::GetDecodedLength("ab\x82", 3));
+
+    CHECK_EQUAL(0, Cp932::Decode("\x82", 1, output, 8, numBytesRead));
+    CHECK_EQUAL(0, numBytesRead);
+    CHECK_EQUAL(0, Cp932::GetDecodedLength("\x82", 1));
+
+    // A lead byte followed by a null terminator ends the string
+    CHECK_EQUAL(1, Cp932::Decode("a\x82\0b", 4, output, 8, numBytesRead));
+    CHECK_EQUAL(1, numBytesRead);
+    CHECK_EQUAL(1, Cp932::GetDecodedLength("a\x82\0b", 4));
+
+    // A full sequence still decodes right before the end
+    CHECK_EQUAL(2, Cp932::Decode("a\x82\xA0", 3, output, 8, numBytesRead));
+    CHECK_EQUAL(3, numBytesRead);
+    CHECK_EQUAL(0x3042, output[1]);
+}
+
+static void CheckLowTrailByteDecoder()
+{
+    wchar_t output[4];
+    int numBytesRead;
+    auto decodeRow1 = [](int leadByteRow, unsigned char trailByte) -> wchar_t
+    {
+        return leadByteRow == 1 && trailByte == 0x21 ? L'\x00E9' : L'\0';
+    };
+
+    // Row 1 is lead byte 0x82; other low trail bytes fall back to the regular decoding
+    CHECK_EQUAL(2, Cp932::Decode("\x82\x21\x83\x21", 4, output, 4, numBytesRead, decodeRow1));
+    CHECK_EQUAL(0x00E9, output[0]);
+    CHECK_EQUAL(0x30FB, output[1]);
+}
+
+// Random mixes of ASCII runs (of every length around the SIMD block sizes), half-width katakana and valid
+// double-byte characters, decoded as a whole and compared against iconv
+static void CheckRandomText(iconv_t converter)
+{
+    vector<pair<unsigned char, unsigned char>> doubleByteChars;
+    for (int leadByte = 0x81; leadByte < 0x100; leadByte++)
+    {
+        if (!Cp932::IsLeadByte((unsigned char)leadByte))
+            continue;
+
+        for (int trailByte = 0x40; trailByte < 0x100; trailByte++)
+        {
+            string text = { (char)leadByte, (char)trailByte };
+            vector<char16_t> reference;
+            if (IconvDecode(converter, text, reference))
+                doubleByteChars.emplace_back(leadByte, trailByte);
+        }
+    }
+
+    mt19937 random(932);
+    vector<wchar_t> decoded;
+    vector<char16_t> reference;
+    for (int iteration = 0; iteration < 2000; iteration++)
+    {
+        string text;
+        int numRuns = random() % 16;
+        for (int run = 0; run < numRuns; run++)
+        {
+            switch (random() % 3)
+            {
+                case 0:
+                {
+                    int length = random() % 70;
+                    for (int i = 0; i < length; i++)
+                    {
+                        text += (char)(1 + random() % 0x7F);
+                    }
+                    break;
+                }
+
+                case 1:
+                    text += (char)(0xA1 + random() % (0xDF - 0xA1 + 1));
+                    break;
+
+                case 2:
+                {
+                    auto [leadByte, trailByte] = doubleByteChars[random() % doubleByteChars.size()];
+                    text += (char)leadByte;
+                    text += (char)trailByte;
+                    break;
+                }
+            }
+        }
+
+        CHECK(IconvDecode(converter, text, reference));
+
+        // Unaligned output so the vector stores don't get lucky
+        decoded.assign(text.size() + 1, L'\0');
+        int numChars = Cp932::Decode(text.data(), text.size(), decoded.data() + 1);
+        CHECK_EQUAL((int)reference.size(), numChars);
+        CHECK_EQUAL(numChars, Cp932::GetDecodedLength(text.data(), text.size()));
+        CHECK(equal(reference.begin(), reference.end(), decoded.begin() + 1));
+
+        // Output that runs out before the input does
+        if (!reference.empty())
+        {
+            int outputSize = random() % reference.size();
+            int numBytesRead;
+            decoded.assign(text.size(), L'\0');
+            CHECK_EQUAL(outputSize, Cp932::Decode(text.data(), text.size(), decoded.data(), outputSize, numBytesRead));
+            CHECK(equal(reference.begin(), reference.begin() + outputSize, decoded.begin()));
+            CHECK_EQUAL(outputSize, Cp932::GetDecodedLength(text.data(), numBytesRead));
+        }
+    }
+}
+
+int main()
+{
+    iconv_t converter = iconv_open("UTF-16LE", "CP932");
+    if (converter == (iconv_t)-1)
+    {
+        fprintf(stderr, "iconv doesn't support CP932\n");
+        return 1;
+    }
+
+    CheckSingleBytes(converter);
+    CheckDoubleBytes(converter);
+    CheckIncompleteSequences();
+    CheckLowTrailByteDecoder();
+    CheckRandomText(converter);
+
+    iconv_close(converter);
+    return TestUtil::TestResult();
+}
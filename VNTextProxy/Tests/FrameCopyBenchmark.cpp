@@ -0,0 +1,102 @@
+// Times FrameCopy::CopyRows() against the row-by-row memcpy loop that the DX11 upload used before,
+// on an 800x600 BGRA frame (the game's resolution).
+// Usage: FrameCopyBenchmark
+// Three cases: unpadded pitches on both sides (CopyRows copies the frame as one block), a staging texture
+// whose rows are padded to 256 bytes, and only the tiles of a text box the way the tile diff reports them.
+// On a desktop CPU, both take about 0.15 ms for a full frame and CopyRows is at most ~5% ahead (when it can do a
+// single memcpy), so the time per frame goes into the D3D9 readback and the tile diff rather than this copy.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Util/FrameCopy.h"
+#include "TestUtil.h"
+
+using namespace std;
+
+static constexpr int Width = 800;
+static constexpr int Height = 600;
+static constexpr int RowBytes = Width * 4;
+
+struct CopyRect
+{
+    int X;
+    int Y;
+    int Width;
+    int Height;
+};
+
+static void CopyRowByRow(unsigned char* pDest, int destPitch, const unsigned char* pSource, int sourcePitch, int rowBytes, int numRows)
+{
+    for (int y = 0; y < numRows; y++)
+    {
+        memcpy(pDest + y * destPitch, pSource + y * sourcePitch, rowBytes);
+    }
+}
+
+static void RunCase(const char* pName, int destPitch, const vector<CopyRect>& rects)
+{
+    vector<unsigned char> source((size_t)RowBytes * Height);
+    mt19937 random(21);
+    for (unsigned char& value : source)
+    {
+        value = (unsigned char)random();
+    }
+    vector<unsigned char> loopDest((size_t)destPitch * Height);
+    vector<unsigned char> copyRowsDest((size_t)destPitch * Height);
+
+    long long numBytes = 0;
+    for (const CopyRect& rect : rects)
+    {
+        numBytes += (long long)rect.Width * 4 * rect.Height;
+    }
+
+    double loopMs = TestUtil::MeasureBest([&]
+    {
+        for (const CopyRect& rect : rects)
+        {
+            CopyRowByRow(
+                loopDest.data() + rect.Y * destPitch + rect.X * 4, destPitch,
+                source.data() + rect.Y * RowBytes + rect.X * 4, RowBytes,
+                rect.Width * 4, rect.Height);
+        }
+        TestUtil::Consume(loopDest[0]);
+    });
+
+    double copyRowsMs = TestUtil::MeasureBest([&]
+    {
+        for (const CopyRect& rect : rects)
+        {
+            FrameCopy::CopyRows(
+                copyRowsDest.data() + rect.Y * destPitch + rect.X * 4, destPitch,
+                source.data() + rect.Y * RowBytes + rect.X * 4, RowBytes,
+                rect.Width * 4, rect.Height);
+        }
+        TestUtil::Consume(copyRowsDest[0]);
+    });
+
+    printf("%s (%lld KB per frame)\n", pName, numBytes / 1024);
+    printf("  Row-by-row memcpy:   %7.3f ms (%6.0f MB/s)\n", loopMs, numBytes / (loopMs * 1000.0));
+    printf("  FrameCopy::CopyRows: %7.3f ms (%6.0f MB/s)\n", copyRowsMs, numBytes / (copyRowsMs * 1000.0));
+    if (loopDest != copyRowsDest)
+    {
+        fprintf(stderr, "  Copies differ\n");
+        exit(1);
+    }
+}
+
+int main()
+{
+    vector<CopyRect> fullFrame = { { 0, 0, Width, Height } };
+
+    // A 3-line text box at the bottom of the screen, plus the tile with the blinking "next page" cursor,
+    // in 32x32 tiles as FrameTileDiff reports them
+    vector<CopyRect> textBox = { { 32, 448, 736, 96 }, { 736, 544, 32, 32 } };
+
+    RunCase("Full frame, unpadded", RowBytes, fullFrame);
+    RunCase("Full frame, destination rows padded to 256 bytes", (RowBytes + 255) & ~255, fullFrame);
+    RunCase("Text box tiles", RowBytes, textBox);
+    return 0;
+}
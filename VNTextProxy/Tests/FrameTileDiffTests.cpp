@@ -0,0 +1,281 @@
+// Checks that FrameTileDiff reports every changed pixel, reports nothing for a static frame, merges dirty tiles into
+// the expected rectangles, and that its SSE2 hash gives the same results as the scalar one.
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Util/FrameTileDiff.h"
+#include "TestUtil.h"
+
+using namespace std;
+
+// FrameTileDiff::HashTile() without SSE2; see ScalarFrameTileDiff.cpp
+uint64_t ScalarHashTile(const unsigned char* pPixels, int pitch, int rowBytes, int numRows);
+
+static constexpr int TileSize = FrameTileDiff::TileSize;
+
+// A frame with padded rows, like a locked D3D9 surface
+struct TestFrame
+{
+    TestFrame(int width, int height, mt19937& random)
+        : Width(width), Height(height), Pitch(width * 4 + 48), Pixels((size_t)Pitch * height)
+    {
+        for (unsigned char& value : Pixels)
+        {
+            value = (unsigned char)random();
+        }
+    }
+
+    uint32_t& Pixel(int x, int y)
+    {
+        return *(uint32_t*)&Pixels[(size_t)y * Pitch + x * 4];
+    }
+
+    int Width;
+    int Height;
+    int Pitch;
+    vector<unsigned char> Pixels;
+};
+
+static bool RectContains(const FrameTileDiff::Rect& rect, int x, int y)
+{
+    return x >= rect.X && x < rect.X + rect.Width && y >= rect.Y && y < rect.Y + rect.Height;
+}
+
+static int CountCoveringRects(const vector<FrameTileDiff::Rect>& rects, int x, int y)
+{
+    int count = 0;
+    for (const FrameTileDiff::Rect& rect : rects)
+    {
+        if (RectContains(rect, x, y))
+            count++;
+    }
+    return count;
+}
+
+// The rectangles have to lie within the frame, start on tile boundaries and not overlap,
+// and together cover exactly the reported number of tiles
+static void CheckRectsConsistent(const FrameTileDiff& diff, int numDirtyTiles)
+{
+    int numCoveredTiles = 0;
+    for (const FrameTileDiff::Rect& rect : diff.GetDirtyRects())
+    {
+        CHECK(rect.Width > 0 && rect.Height > 0);
+        CHECK(rect.X >= 0 && rect.X + rect.Width <= diff.GetWidth());
+        CHECK(rect.Y >= 0 && rect.Y + rect.Height <= diff.GetHeight());
+        CHECK_EQUAL(0, rect.X % TileSize);
+        CHECK_EQUAL(0, rect.Y % TileSize);
+        numCoveredTiles += ((rect.Width + TileSize - 1) / TileSize) * ((rect.Height + TileSize - 1) / TileSize);
+    }
+    CHECK_EQUAL(numDirtyTiles, numCoveredTiles);
+
+    for (int y = 0; y < diff.GetHeight(); y += TileSize)
+    {
+        for (int x = 0; x < diff.GetWidth(); x += TileSize)
+        {
+            CHECK(CountCoveringRects(diff.GetDirtyRects(), x, y) <= 1);
+        }
+    }
+}
+
+// Random pixel changes (always including the corners, which are in partial tiles when the size isn't a multiple
+// of TileSize) have to show up in the reported rectangles, and going back to a frame that was just uploaded
+// doesn't report anything
+static void CheckFrameSize(int width, int height)
+{
+    mt19937 random(width * 1000 + height);
+    TestFrame frame(width, height, random);
+
+    FrameTileDiff diff;
+    diff.Reset(width, height);
+
+    // The first frame is reported in full
+    int numDirtyTiles = diff.Update(frame.Pixels.data(), frame.Pitch);
+    CHECK_EQUAL(diff.GetNumTiles(), numDirtyTiles);
+    CHECK_EQUAL(((width + TileSize - 1) / TileSize) * ((height + TileSize - 1) / TileSize), diff.GetNumTiles());
+    CheckRectsConsistent(diff, numDirtyTiles);
+
+    // A static frame reports nothing, even if the row padding changes
+    for (int y = 0; y < height; y++)
+    {
+        memset(&frame.Pixels[(size_t)y * frame.Pitch + width * 4], y, frame.Pitch - width * 4);
+    }
+    CHECK_EQUAL(0, diff.Update(frame.Pixels.data(), frame.Pitch));
+    CHECK(diff.GetDirtyRects().empty());
+
+    for (int round = 0; round < 50; round++)
+    {
+        vector<pair<int, int>> changedPixels;
+        int numChanges = 1 + random() % 12;
+        for (int i = 0; i < numChanges; i++)
+        {
+            changedPixels.emplace_back(random() % width, random() % height);
+        }
+        if (round == 0)
+        {
+            changedPixels = { { 0, 0 }, { width - 1, 0 }, { 0, height - 1 }, { width - 1, height - 1 } };
+        }
+
+        for (auto [x, y] : changedPixels)
+        {
+            frame.Pixel(x, y) ^= 1u << (random() % 32);
+        }
+
+        numDirtyTiles = diff.Update(frame.Pixels.data(), frame.Pitch);
+        CHECK(numDirtyTiles > 0);
+        CheckRectsConsistent(diff, numDirtyTiles);
+        for (auto [x, y] : changedPixels)
+        {
+            CHECK_EQUAL(1, CountCoveringRects(diff.GetDirtyRects(), x, y));
+        }
+
+        CHECK_EQUAL(0, diff.Update(frame.Pixels.data(), frame.Pitch));
+        CHECK(diff.GetDirtyRects().empty());
+    }
+
+    // Reset() forgets the previous frame
+    diff.Reset(width, height);
+    CHECK_EQUAL(diff.GetNumTiles(), diff.Update(frame.Pixels.data(), frame.Pitch));
+}
+
+// Changes whole tiles in the given tile rows/columns of a 256x256 frame (8x8 tiles) and returns the reported rectangles
+static vector<FrameTileDiff::Rect> GetRectsForTiles(const vector<pair<int, int>>& tiles)
+{
+    mt19937 random(22);
+    TestFrame frame(8 * TileSize, 8 * TileSize, random);
+    FrameTileDiff diff;
+    diff.Reset(frame.Width, frame.Height);
+    diff.Update(frame.Pixels.data(), frame.Pitch);
+
+    for (auto [tileX, tileY] : tiles)
+    {
+        frame.Pixel(tileX * TileSize + 5, tileY * TileSize + 7) ^= 0x00010000;
+    }
+    int numDirtyTiles = diff.Update(frame.Pixels.data(), frame.Pitch);
+    CHECK_EQUAL((int)tiles.size(), numDirtyTiles);
+    CheckRectsConsistent(diff, numDirtyTiles);
+    return diff.GetDirtyRects();
+}
+
+static bool HasRect(const vector<FrameTileDiff::Rect>& rects, int tileX, int tileY, int tilesWide, int tilesHigh)
+{
+    for (const FrameTileDiff::Rect& rect : rects)
+    {
+        if (rect.X == tileX * TileSize && rect.Y == tileY * TileSize &&
+            rect.Width == tilesWide * TileSize && rect.Height == tilesHigh * TileSize)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void CheckRectMerging()
+{
+    // A 3x3 block of tiles becomes a single rectangle
+    vector<FrameTileDiff::Rect> rects = GetRectsForTiles({
+        { 2, 3 }, { 3, 3 }, { 4, 3 },
+        { 2, 4 }, { 3, 4 }, { 4, 4 },
+        { 2, 5 }, { 3, 5 }, { 4, 5 }
+    });
+    CHECK_EQUAL(1, (int)rects.size());
+    CHECK(HasRect(rects, 2, 3, 3, 3));
+
+    // Two columns of tiles side by side in the same rows are merged vertically, each on its own
+    rects = GetRectsForTiles({
+        { 0, 1 }, { 1, 1 }, { 5, 1 },
+        { 0, 2 }, { 1, 2 }, { 5, 2 },
+        { 0, 3 }, { 1, 3 }, { 5, 3 }
+    });
+    CHECK_EQUAL(2, (int)rects.size());
+    CHECK(HasRect(rects, 0, 1, 2, 3));
+    CHECK(HasRect(rects, 5, 1, 1, 3));
+
+    // Runs that span different columns aren't merged...
+    rects = GetRectsForTiles({
+        { 1, 0 }, { 2, 0 }, { 3, 0 },
+        { 1, 1 }, { 2, 1 },
+        { 1, 2 }, { 2, 2 }
+    });
+    CHECK_EQUAL(2, (int)rects.size());
+    CHECK(HasRect(rects, 1, 0, 3, 1));
+    CHECK(HasRect(rects, 1, 1, 2, 2));
+
+    // ...and neither are runs with a clean tile row in between
+    rects = GetRectsForTiles({ { 6, 0 }, { 7, 0 }, { 6, 2 }, { 7, 2 } });
+    CHECK_EQUAL(2, (int)rects.size());
+    CHECK(HasRect(rects, 6, 0, 2, 1));
+    CHECK(HasRect(rects, 6, 2, 2, 1));
+
+    // Merging into a rectangle that isn't the last one added
+    rects = GetRectsForTiles({ { 0, 6 }, { 4, 6 }, { 0, 7 }, { 4, 7 } });
+    CHECK_EQUAL(2, (int)rects.size());
+    CHECK(HasRect(rects, 0, 6, 1, 2));
+    CHECK(HasRect(rects, 4, 6, 1, 2));
+
+    // Partial tiles along the right and bottom edges are clipped, and still merge
+    mt19937 random(23);
+    TestFrame frame(100, 70, random);
+    FrameTileDiff diff;
+    diff.Reset(frame.Width, frame.Height);
+    diff.Update(frame.Pixels.data(), frame.Pitch);
+    frame.Pixel(99, 40) ^= 1;
+    frame.Pixel(99, 69) ^= 1;
+    CHECK_EQUAL(2, diff.Update(frame.Pixels.data(), frame.Pitch));
+    CHECK_EQUAL(1, (int)diff.GetDirtyRects().size());
+    if (diff.GetDirtyRects().size() == 1)
+    {
+        const FrameTileDiff::Rect& rect = diff.GetDirtyRects()[0];
+        CHECK_EQUAL(96, rect.X);
+        CHECK_EQUAL(32, rect.Y);
+        CHECK_EQUAL(4, rect.Width);
+        CHECK_EQUAL(38, rect.Height);
+    }
+}
+
+// Every tile shape HashTile() gets called with, on random data and on data that only differs in a single bit
+static void CheckScalarHashMatches()
+{
+    mt19937 random(24);
+    int pitch = TileSize * 4 + 12;
+    vector<unsigned char> tile((size_t)pitch * TileSize);
+    for (int round = 0; round < 20; round++)
+    {
+        for (unsigned char& value : tile)
+        {
+            value = (unsigned char)random();
+        }
+
+        for (int numRows = 1; numRows <= TileSize; numRows++)
+        {
+            for (int rowBytes = 4; rowBytes <= TileSize * 4; rowBytes += 4)
+            {
+                uint64_t hash = FrameTileDiff::HashTile(tile.data(), pitch, rowBytes, numRows);
+                CHECK(hash == ScalarHashTile(tile.data(), pitch, rowBytes, numRows));
+
+                // Flipping a bit inside the tile changes the hash
+                size_t offset = (size_t)(random() % numRows) * pitch + random() % rowBytes;
+                unsigned char bit = (unsigned char)(1 << (random() % 8));
+                tile[offset] ^= bit;
+                uint64_t changedHash = FrameTileDiff::HashTile(tile.data(), pitch, rowBytes, numRows);
+                CHECK(changedHash != hash);
+                CHECK(changedHash == ScalarHashTile(tile.data(), pitch, rowBytes, numRows));
+                tile[offset] ^= bit;
+            }
+        }
+    }
+}
+
+int main()
+{
+    CheckFrameSize(800, 600);
+    CheckFrameSize(1024, 768);
+    CheckFrameSize(801, 599);
+    CheckFrameSize(37, 33);
+    CheckFrameSize(31, 1);
+    CheckFrameSize(4, 70);
+    CheckRectMerging();
+    CheckScalarHashMatches();
+    return TestUtil::TestResult();
+}
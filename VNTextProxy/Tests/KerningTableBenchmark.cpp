@@ -0,0 +1,116 @@
+// Replays the character pairs of a script through KerningTable and through the std::map<DWORD, int>
+// that Font used to keep the GetKerningPairsW() amounts in.
+// Usage: KerningTableBenchmark [path to a UTF-8 script]
+// Without a path, generated English dialogue is used. The kerning pairs are modeled on a Latin text font
+// (about 500 pairs between capitals, lowercase letters, digits and punctuation), since the fonts in this
+// repository only have GPOS kerning, which GetKerningPairsW() doesn't report.
+#include "pch.h"
+
+#include <random>
+
+#include "TestUtil.h"
+
+using namespace std;
+
+static vector<pair<DWORD, int>> GenerateKerningPairs()
+{
+    static const wchar_t KernedFirst[] = L"AFKLPRTVWYfkrvwy1'\"(.,";
+    static const wchar_t KernedSecond[] = L"AJOTVWYacdegmnopqrsuvwxyz.,-:;'\")?!";
+    mt19937 random(19);
+    vector<pair<DWORD, int>> pairs;
+    for (wchar_t first : wstring(KernedFirst))
+    {
+        for (wchar_t second : wstring(KernedSecond))
+        {
+            if (random() % 3 != 0)
+                pairs.emplace_back(first | (second << 16), -1 - (int)(random() % 6));
+        }
+    }
+    return pairs;
+}
+
+static vector<wstring> GenerateScript()
+{
+    static const wchar_t* const Words[] = {
+        L"I", L"you", L"the", L"a", L"to", L"it's", L"that", L"What", L"Yeah,", L"don't", L"know", L"We",
+        L"really", L"Tomorrow", L"AVATAR", L"\"Wait!\"", L"(sigh)", L"Tanaka-san.", L"never", L"away", L"very",
+        L"Yuki", L"Fine.", L"over", L"there...", L"Where", L"To", L"Vows", L"typewriter", L"LOVE", L"school?"
+    };
+
+    mt19937 random(20);
+    vector<wstring> lines;
+    for (int i = 0; i < 50000; i++)
+    {
+        wstring line;
+        int numWords = 3 + random() % 18;
+        for (int j = 0; j < numWords; j++)
+        {
+            if (!line.empty())
+                line += L' ';
+
+            line += Words[random() % size(Words)];
+        }
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+int main(int argc, char** argv)
+{
+    vector<wstring> lines = argc > 1 ? TestUtil::ReadUtf8Lines(argv[1]) : GenerateScript();
+    vector<pair<DWORD, int>> kerningPairs = GenerateKerningPairs();
+
+    map<DWORD, int> kernAmountMap;
+    KerningTable kernAmountTable;
+    kernAmountTable.Reserve(kerningPairs.size());
+    for (auto [key, amount] : kerningPairs)
+    {
+        kernAmountMap[key] = amount;
+        kernAmountTable.Set((wchar_t)(key & 0xFFFF), (wchar_t)(key >> 16), amount);
+    }
+
+    // The lookups Proportionalizer does: one per character and the character after it
+    vector<pair<wchar_t, wchar_t>> charPairs;
+    for (const wstring& line : lines)
+    {
+        for (size_t i = 0; i + 1 < line.size(); i++)
+        {
+            charPairs.emplace_back(line[i], line[i + 1]);
+        }
+    }
+
+    long long mapTotal = 0;
+    double mapMs = TestUtil::MeasureBest([&]
+    {
+        mapTotal = 0;
+        for (auto [first, second] : charPairs)
+        {
+            DWORD key = first | (second << 16);
+            auto it = kernAmountMap.find(key);
+            mapTotal += it != kernAmountMap.end() ? it->second : 0;
+        }
+        TestUtil::Consume(mapTotal);
+    });
+
+    long long tableTotal = 0;
+    double tableMs = TestUtil::MeasureBest([&]
+    {
+        tableTotal = 0;
+        for (auto [first, second] : charPairs)
+        {
+            int amount;
+            tableTotal += kernAmountTable.TryGet(first, second, amount) ? amount : 0;
+        }
+        TestUtil::Consume(tableTotal);
+    });
+
+    printf("%zu kerning pairs, %zu character pairs looked up\n", kerningPairs.size(), charPairs.size());
+    printf("std::map:     %7.2f ms (%5.1f ns per lookup)\n", mapMs, mapMs * 1e6 / charPairs.size());
+    printf("KerningTable: %7.2f ms (%5.1f ns per lookup)\n", tableMs, tableMs * 1e6 / charPairs.size());
+    if (mapTotal != tableTotal)
+    {
+        fprintf(stderr, "Kerning totals differ: %lld vs. %lld\n", mapTotal, tableTotal);
+        return 1;
+    }
+    return 0;
+}
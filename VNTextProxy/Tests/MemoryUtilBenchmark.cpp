@@ -0,0 +1,166 @@
+// Scans a multi-MB buffer for the kinds of patterns the proxy looks for at startup, with MemoryUtil::FindData
+// and with the byte-by-byte loops it replaced (copied below as they were).
+// Usage: MemoryUtilBenchmark [path to a game executable]
+// Without a path, 16 MB of generated data with the byte distribution of x86 code is scanned.
+#include "pch.h"
+
+#include <fstream>
+#include <iterator>
+#include <random>
+
+#include "TestUtil.h"
+
+using namespace std;
+
+static void* FindDataBytewise(const void* pHaystack, int haystackLength, const void* pNeedle, int needleLength)
+{
+    BYTE* pTest = (BYTE*)pHaystack;
+    BYTE* pEnd = pTest + haystackLength - needleLength;
+    for (; pTest <= pEnd; pTest++)
+    {
+        if (memcmp(pTest, pNeedle, needleLength) == 0)
+            return pTest;
+    }
+    return nullptr;
+}
+
+static void* FindDataBytewise(const void* pHaystack, int haystackLength, const void* pNeedle, const void* pNeedleMask, int needleLength)
+{
+    BYTE* pTest = (BYTE*)pHaystack;
+    BYTE* pEnd = pTest + haystackLength - needleLength;
+    for (; pTest <= pEnd; pTest++)
+    {
+        int offset = 0;
+        bool failed = false;
+        for (; offset < (needleLength & ~3); offset += 4)
+        {
+            DWORD test, needle, mask;
+            memcpy(&test, pTest + offset, 4);
+            memcpy(&needle, (BYTE*)pNeedle + offset, 4);
+            memcpy(&mask, (BYTE*)pNeedleMask + offset, 4);
+            if ((test & mask) != needle)
+            {
+                failed = true;
+                break;
+            }
+        }
+        if (failed)
+            continue;
+
+        for (; offset < needleLength; offset++)
+        {
+            BYTE test   = pTest[offset];
+            BYTE needle = *((BYTE*)pNeedle + offset);
+            BYTE mask   = *((BYTE*)pNeedleMask + offset);
+            if ((test & mask) != needle)
+            {
+                failed = true;
+                break;
+            }
+        }
+        if (failed)
+            continue;
+
+        return pTest;
+    }
+    return nullptr;
+}
+
+static vector<BYTE> GenerateImage()
+{
+    // Rough opcode/operand frequencies of 32-bit MSVC code, with zero padding and ASCII strings mixed in
+    static const BYTE CommonBytes[] = {
+        0x00, 0x00, 0x00, 0x00, 0x8B, 0x8B, 0x89, 0xFF, 0xFF, 0x45, 0x4D, 0x55, 0xE8, 0x83, 0xC4, 0x0F,
+        0x85, 0x84, 0x74, 0x75, 0x50, 0x51, 0x52, 0x56, 0x57, 0x6A, 0x01, 0x24, 0x08, 0x04, 0xCC, 0xC3
+    };
+
+    mt19937 random(7);
+    vector<BYTE> image(16 << 20);
+    for (size_t i = 0; i < image.size(); )
+    {
+        if (random() % 64 == 0)
+        {
+            static const char Text[] = "CreateWindowExW\0GetProcAddress\0.?AVexception@std@@\0";
+            size_t length = min(sizeof(Text), image.size() - i);
+            memcpy(&image[i], Text, length);
+            i += length;
+        }
+        else
+        {
+            image[i++] = random() % 4 != 0 ? CommonBytes[random() % size(CommonBytes)] : (BYTE)random();
+        }
+    }
+    return image;
+}
+
+struct Needle
+{
+    const char* pName;
+    vector<BYTE> Bytes;
+    vector<BYTE> Mask;
+};
+
+int main(int argc, char** argv)
+{
+    vector<BYTE> image;
+    if (argc > 1)
+    {
+        ifstream file(argv[1], ios::binary);
+        image.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    }
+    else
+    {
+        image = GenerateImage();
+    }
+    printf("Scanning %.1f MB\n", image.size() / 1e6);
+
+    vector<Needle> needles = {
+        {
+            "SJIS lookup table (32 bytes)",
+            {
+                0x00, 0x30, 0x01, 0x30, 0x02, 0x30, 0x0C, 0xFF, 0x0E, 0xFF, 0xFB, 0x30, 0x1A, 0xFF, 0x1B, 0xFF,
+                0x1F, 0xFF, 0x01, 0xFF, 0x9B, 0x30, 0x9C, 0x30, 0xB4, 0x00, 0x40, 0xFF, 0xA8, 0x00, 0x3E, 0xFF
+            },
+            {}
+        },
+        { "\"Borland\"", { 'B', 'o', 'r', 'l', 'a', 'n', 'd' }, {} },
+        { "RTTI type name", vector<BYTE>((const BYTE*)".?AVCScriptEngine@@", (const BYTE*)".?AVCScriptEngine@@" + 19), {} },
+        {
+            "Masked code (mov ecx, [imm32]; test ecx, ecx; jz)",
+            { 0x8B, 0x0D, 0x00, 0x00, 0x00, 0x00, 0x85, 0xC9, 0x74, 0x00 },
+            { 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0x00 }
+        },
+        {
+            "Masked code (push imm8; call rel32; add esp)",
+            { 0x6A, 0x00, 0xE8, 0x00, 0x00, 0x00, 0x00, 0x83, 0xC4, 0x04 },
+            { 0xFF, 0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF }
+        }
+    };
+
+    int numMismatches = 0;
+    for (const Needle& needle : needles)
+    {
+        const void* pMask = needle.Mask.empty() ? nullptr : needle.Mask.data();
+        void* pOldMatch = nullptr;
+        void* pNewMatch = nullptr;
+        double oldMs = TestUtil::MeasureBest([&]
+        {
+            pOldMatch = pMask == nullptr
+                ? FindDataBytewise(image.data(), image.size(), needle.Bytes.data(), needle.Bytes.size())
+                : FindDataBytewise(image.data(), image.size(), needle.Bytes.data(), pMask, needle.Bytes.size());
+        });
+        double newMs = TestUtil::MeasureBest([&]
+        {
+            pNewMatch = pMask == nullptr
+                ? MemoryUtil::FindData(image.data(), image.size(), needle.Bytes.data(), needle.Bytes.size())
+                : MemoryUtil::FindData(image.data(), image.size(), needle.Bytes.data(), pMask, needle.Bytes.size());
+        });
+
+        string match = pNewMatch == nullptr ? "not found" : "found at " + to_string((BYTE*)pNewMatch - image.data());
+        printf("%-50s bytewise %7.2f ms, FindData %6.2f ms (%5.1fx), %s%s\n",
+            needle.pName, oldMs, newMs, oldMs / newMs, match.c_str(), pOldMatch == pNewMatch ? "" : ", RESULT MISMATCH");
+        if (pOldMatch != pNewMatch)
+            numMismatches++;
+    }
+    return numMismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,14 @@
+// FrameTileDiff.cpp built once more without its SSE2 path (CMakeLists.txt compiles this file with __SSE2__
+// undefined), under a different class name so it can be linked next to the regular build and compared with it.
+#define FrameTileDiff ScalarFrameTileDiff
+#include "Util/FrameTileDiff.cpp"
+#undef FrameTileDiff
+
+#if FRAMETILEDIFF_SSE2
+#error ScalarFrameTileDiff.cpp must be compiled without SSE2
+#endif
+
+uint64_t ScalarHashTile(const unsigned char* pPixels, int pitch, int rowBytes, int numRows)
+{
+    return ScalarFrameTileDiff::HashTile(pPixels, pitch, rowBytes, numRows);
+}
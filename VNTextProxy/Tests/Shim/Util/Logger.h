@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdarg>
+#include <cstdio>
+
+// Stands in for VNTextProxy's Util/Logger.h in the Linux tests: log lines go to stderr, whatever their category.
+
+enum class LogCategory
+{
+    TEXT,
+    HOOKS,
+    DX9,
+    DX11,
+    SHADER
+};
+
+inline void proxy_log(LogCategory category, const char* pFormat, ...)
+{
+    va_list args;
+    va_start(args, pFormat);
+    vfprintf(stderr, pFormat, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
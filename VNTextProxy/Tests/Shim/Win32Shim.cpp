@@ -0,0 +1,175 @@
+#include "pch.h"
+
+using namespace std;
+
+// Unicode -> CP932 table built from Cp932's decoding tables. Where several byte sequences decode to the same
+// character (the NEC/IBM duplicates), the first one wins, which is also what Windows picks for most of them.
+static const vector<WORD>& GetEncodeTable()
+{
+    static vector<WORD> table = []
+    {
+        vector<WORD> table(0x10000, 0);
+        for (int byte = 0x01; byte < 0x100; byte++)
+        {
+            if ((byte < 0x80 || (byte >= 0xA1 && byte <= 0xDF)) && table[Cp932::DecodeSingleByte(byte)] == 0)
+                table[Cp932::DecodeSingleByte(byte)] = byte;
+        }
+
+        for (int leadByte = 0x81; leadByte < 0x100; leadByte++)
+        {
+            if (!Cp932::IsLeadByte(leadByte))
+                continue;
+
+            for (int trailByte = Cp932::MinTrailByte; trailByte < 0x100; trailByte++)
+            {
+                wchar_t c = Cp932::DecodeDoubleByte(leadByte, trailByte);
+                bool unmapped = c == 0x30FB && !(leadByte == 0x81 && trailByte == 0x45);
+                if (!unmapped && table[c] == 0)
+                    table[c] = (WORD)((leadByte << 8) | trailByte);
+            }
+        }
+        return table;
+    }();
+    return table;
+}
+
+int WideCharToMultiByte(UINT codePage, DWORD flags, LPCWCH pWideChars, int numWideChars, LPSTR pMultiByte, int multiByteSize,
+                        LPCCH pDefaultChar, LPBOOL pUsedDefaultChar)
+{
+    if (codePage != 932)
+        throw invalid_argument("Only code page 932 is supported");
+
+    const vector<WORD>& table = GetEncodeTable();
+    bool usedDefaultChar = false;
+    int length = 0;
+    for (int i = 0; i < numWideChars; i++)
+    {
+        wchar_t c = pWideChars[i];
+        WORD multiByte = c == L'\0' ? 0 : c < 0x10000 ? table[c] : 0;
+        if (c != L'\0' && multiByte == 0)
+        {
+            usedDefaultChar = true;
+            multiByte = '?';
+        }
+
+        if (multiByte >= 0x100)
+        {
+            if (length + 2 > multiByteSize)
+                return 0;
+
+            pMultiByte[length++] = (char)(multiByte >> 8);
+            pMultiByte[length++] = (char)multiByte;
+        }
+        else
+        {
+            if (length + 1 > multiByteSize)
+                return 0;
+
+            pMultiByte[length++] = (char)multiByte;
+        }
+    }
+
+    if (pUsedDefaultChar != nullptr)
+        *pUsedDefaultChar = usedDefaultChar;
+
+    return length;
+}
+
+// The handles point to these; a file mapping is just another handle to the same file
+struct ShimFile
+{
+    vector<BYTE> Contents;
+};
+
+static string ToNarrow(const wchar_t* pText)
+{
+    string result;
+    for (; *pText != L'\0'; pText++)
+    {
+        result += (char)*pText;
+    }
+    return result;
+}
+
+HANDLE CreateFileW(const wchar_t* pFileName, DWORD access, DWORD shareMode, void* pSecurityAttributes, DWORD creationDisposition,
+                   DWORD flags, HANDLE hTemplateFile)
+{
+    FILE* pFile = fopen(ToNarrow(pFileName).c_str(), "rb");
+    if (pFile == nullptr)
+        return INVALID_HANDLE_VALUE;
+
+    ShimFile* pShimFile = new ShimFile();
+    BYTE buffer[0x1000];
+    size_t numBytesRead;
+    while ((numBytesRead = fread(buffer, 1, sizeof(buffer), pFile)) != 0)
+    {
+        pShimFile->Contents.insert(pShimFile->Contents.end(), buffer, buffer + numBytesRead);
+    }
+    fclose(pFile);
+    return pShimFile;
+}
+
+DWORD GetFileSize(HANDLE hFile, DWORD* pFileSizeHigh)
+{
+    if (pFileSizeHigh != nullptr)
+        *pFileSizeHigh = 0;
+
+    return (DWORD)((ShimFile*)hFile)->Contents.size();
+}
+
+HANDLE CreateFileMappingW(HANDLE hFile, void* pAttributes, DWORD protect, DWORD maxSizeHigh, DWORD maxSizeLow, const wchar_t* pName)
+{
+    return new ShimFile(*(ShimFile*)hFile);
+}
+
+void* MapViewOfFile(HANDLE hMapping, DWORD access, DWORD offsetHigh, DWORD offsetLow, size_t numBytes)
+{
+    const vector<BYTE>& contents = ((ShimFile*)hMapping)->Contents;
+    BYTE* pView = new BYTE[contents.size()];
+    memcpy(pView, contents.data(), contents.size());
+    return pView;
+}
+
+BOOL UnmapViewOfFile(const void* pAddress)
+{
+    delete[] (const BYTE*)pAddress;
+    return 1;
+}
+
+BOOL CloseHandle(HANDLE handle)
+{
+    delete (ShimFile*)handle;
+    return 1;
+}
+
+int MessageBoxW(HWND hWnd, const wchar_t* pText, const wchar_t* pCaption, UINT type)
+{
+    fprintf(stderr, "%s: %s\n", ToNarrow(pCaption).c_str(), ToNarrow(pText).c_str());
+    return 1;
+}
+
+void ExitProcess(UINT exitCode)
+{
+    fflush(stderr);
+    exit(exitCode);
+}
+
+wstring Path::Combine(const wstring& path1, const wstring& path2)
+{
+    return path1 + L"/" + path2;
+}
+
+wstring Path::GetModuleFolderPath(HMODULE hModule)
+{
+    return L".";
+}
+
+int SignatureScanner::AddPattern(SignatureRegion region, const void* pPattern, int length)
+{
+    return 0;
+}
+
+void* SignatureScanner::GetMatch(int patternId)
+{
+    return nullptr;
+}
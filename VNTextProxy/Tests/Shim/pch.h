@@ -0,0 +1,100 @@
+#pragma once
+
+// Stands in for VNTextProxy's pch.h when a module that uses it is built for the Linux tests.
+// Provides just enough of the Win32 API and of the proxy's other classes for those modules to compile;
+// see Win32Shim.cpp for what the functions do.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef uint32_t DWORD;
+typedef int BOOL;
+typedef unsigned int UINT;
+typedef void* HANDLE;
+typedef void* HMODULE;
+typedef void* HWND;
+typedef const char* LPCCH;
+typedef const wchar_t* LPCWCH;
+typedef char* LPSTR;
+typedef BOOL* LPBOOL;
+
+#define INVALID_HANDLE_VALUE ((HANDLE)(intptr_t)-1)
+#define INVALID_FILE_SIZE ((DWORD)0xFFFFFFFF)
+#define GENERIC_READ 0x80000000
+#define FILE_SHARE_READ 0x00000001
+#define OPEN_EXISTING 3
+#define FILE_ATTRIBUTE_NORMAL 0x00000080
+#define PAGE_READONLY 0x02
+#define FILE_MAP_READ 0x0004
+#define WC_NO_BEST_FIT_CHARS 0x00000400
+#define MB_ICONERROR 0x00000010
+
+// Only code page 932 is supported. Characters that CP932 can't represent (exactly) are reported through pUsedDefaultChar.
+int WideCharToMultiByte(UINT codePage, DWORD flags, LPCWCH pWideChars, int numWideChars, LPSTR pMultiByte, int multiByteSize,
+                        LPCCH pDefaultChar, LPBOOL pUsedDefaultChar);
+
+// Files are opened for reading only (the path must be ASCII), and mapping one gives a copy of its contents
+HANDLE CreateFileW(const wchar_t* pFileName, DWORD access, DWORD shareMode, void* pSecurityAttributes, DWORD creationDisposition,
+                   DWORD flags, HANDLE hTemplateFile);
+DWORD GetFileSize(HANDLE hFile, DWORD* pFileSizeHigh);
+HANDLE CreateFileMappingW(HANDLE hFile, void* pAttributes, DWORD protect, DWORD maxSizeHigh, DWORD maxSizeLow, const wchar_t* pName);
+void* MapViewOfFile(HANDLE hMapping, DWORD access, DWORD offsetHigh, DWORD offsetLow, size_t numBytes);
+BOOL UnmapViewOfFile(const void* pAddress);
+BOOL CloseHandle(HANDLE handle);
+
+// Prints the message to stderr
+int MessageBoxW(HWND hWnd, const wchar_t* pText, const wchar_t* pCaption, UINT type);
+[[noreturn]] void ExitProcess(UINT exitCode);
+
+inline void YieldProcessor()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+class Path
+{
+public:
+    static std::wstring     Combine                     (const std::wstring& path1, const std::wstring& path2);
+    static std::wstring     GetModuleFolderPath         (HMODULE hModule);
+};
+
+class MemoryUnprotector
+{
+public:
+    MemoryUnprotector(void* ptr, int length) { }
+};
+
+enum class SignatureRegion
+{
+    Image
+};
+
+// Never finds anything
+class SignatureScanner
+{
+public:
+    static int                  AddPattern          (SignatureRegion region, const void* pPattern, int length);
+    static void*                GetMatch            (int patternId);
+};
+
+#include "Util/Cp932.h"
+#include "Util/MemoryUtil.h"
+#include "KerningTable.h"
+#include "SjisTunnelEncoding.h"
@@ -0,0 +1,118 @@
+// Encodes a full translated script with SjisTunnelEncoding::Encode, compared against the linear scan through
+// the mapping list that it used to do for characters that CP932 can't represent.
+// Usage: SjisTunnelEncodingBenchmark [path to a UTF-8 script]
+// Without a path, a generated English script is used in which about one word in three starts with a character
+// that needs tunneling.
+#include "pch.h"
+
+#include <random>
+
+#include "TestUtil.h"
+
+using namespace std;
+
+// English dialogue with accented letters, typographic punctuation and symbols from a pool of about 2500 characters
+// outside CP932, so that the mapping table fills up the way it does in a heavily tunneled translation
+static vector<wstring> GenerateScript()
+{
+    vector<wchar_t> tunneledChars;
+    for (wchar_t c = 0x00C0; c < 0x0250; c++)
+    {
+        tunneledChars.push_back(c);
+    }
+    for (wchar_t c = 0x1E00; c < 0x1F00; c++)
+    {
+        tunneledChars.push_back(c);
+    }
+    for (wchar_t c = 0xAC00; c < 0xB200; c++)
+    {
+        tunneledChars.push_back(c);
+    }
+
+    // Remove the few that CP932 does have
+    erase_if(tunneledChars, [](wchar_t c)
+    {
+        char multibyte[2];
+        BOOL failed;
+        WideCharToMultiByte(932, WC_NO_BEST_FIT_CHARS, &c, 1, multibyte, sizeof(multibyte), nullptr, &failed);
+        return !failed;
+    });
+
+    static const wchar_t* const Words[] = {
+        L"the", L"you", L"and", L"that", L"what", L"just", L"don't", L"here", L"know", L"really",
+        L"senpai", L"café", L"naïve", L"“wait”", L"—", L"…", L"school", L"tomorrow"
+    };
+
+    mt19937 random(2);
+    vector<wstring> lines;
+    for (int i = 0; i < 60000; i++)
+    {
+        wstring line;
+        int numWords = 4 + random() % 20;
+        for (int j = 0; j < numWords; j++)
+        {
+            if (!line.empty())
+                line += L' ';
+
+            if (random() % 3 == 0)
+                line += tunneledChars[random() % tunneledChars.size()];
+
+            line += Words[random() % size(Words)];
+        }
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+int main(int argc, char** argv)
+{
+    vector<wstring> lines = argc > 1 ? TestUtil::ReadUtf8Lines(argv[1]) : GenerateScript();
+    size_t numChars = 0;
+    for (const wstring& line : lines)
+    {
+        numChars += line.size();
+    }
+
+    // What Encode() used to do: a WideCharToMultiByte() per character, and for the ones that fail,
+    // a search through the list of characters that have been given a tunnel slot so far
+    vector<wchar_t> mappings;
+    double linearMs = TestUtil::MeasureBest([&]
+    {
+        for (const wstring& line : lines)
+        {
+            string result;
+            for (wchar_t c : line)
+            {
+                char multibyte[2];
+                BOOL failed;
+                int multibyteLength = WideCharToMultiByte(932, WC_NO_BEST_FIT_CHARS, &c, 1, multibyte, sizeof(multibyte), nullptr, &failed);
+                if (failed || (BYTE)multibyte[0] >= 0xF0)
+                {
+                    auto it = find(mappings.begin(), mappings.end(), c);
+                    int mappingIdx = it - mappings.begin();
+                    if (it == mappings.end())
+                        mappings.push_back(c);
+
+                    multibyte[0] = (char)(0x81 + mappingIdx / 58);
+                    multibyte[1] = (char)(1 + mappingIdx % 58);
+                    multibyteLength = 2;
+                }
+                result.append(multibyte, multibyteLength);
+            }
+            TestUtil::Consume(result.size());
+        }
+    });
+
+    double indexedMs = TestUtil::MeasureBest([&]
+    {
+        for (const wstring& line : lines)
+        {
+            TestUtil::Consume(SjisTunnelEncoding::Encode(line).size());
+        }
+    });
+
+    printf("%zu lines, %zu characters, %zu of them tunneled\n", lines.size(), numChars, mappings.size());
+    printf("Linear scan:  %8.2f ms (%6.1f M chars/s)\n", linearMs, numChars / 1e3 / linearMs);
+    printf("Encode():     %8.2f ms (%6.1f M chars/s)\n", indexedMs, numChars / 1e3 / indexedMs);
+    return 0;
+}
@@ -0,0 +1,197 @@
+// Loads an sjis_ext.bin that's laid out the way VNTextPatch writes it (SjisTunnelEncoding.GetMappingTable() in
+// VNTextPatch.Shared) and checks that every character gets the tunnel code VNTextPatch gave it, which also checks
+// that the hashes of the reverse table agree. The file is read from the working directory on the first conversion,
+// so each case runs in a process of its own:
+//   SjisTunnelEncodingFileTests valid|legacy      checks the conversions
+//   SjisTunnelEncodingFileTests <corruption>      writes a damaged file, which the proxy has to refuse to run with
+#include "pch.h"
+
+#include <fstream>
+
+#include "TestUtil.h"
+
+using namespace std;
+
+static constexpr int NumFileChars = 1500;
+
+// Hangul syllables: none of them are in CP932
+static wchar_t GetTunneledChar(int index)
+{
+    return (wchar_t)(0xAC00 + index);
+}
+
+// SjisTunnelEncoding.GetSjisTunnelChar() in VNTextPatch
+static WORD GetVNTextPatchTunnelCode(int mappingIdx)
+{
+    int highIdx = mappingIdx / 0x3A;
+    int lowIdx = mappingIdx % 0x3A;
+    int highByte = highIdx < 0x1F ? 0x81 + highIdx : 0xE0 + (highIdx - 0x1F);
+    int lowByte = 1 + lowIdx;
+    for (char avoided : { '\t', '\n', '\r', ' ', ',' })
+    {
+        if (lowByte >= avoided)
+            lowByte++;
+    }
+    return (WORD)((highByte << 8) | lowByte);
+}
+
+// SjisTunnelEncoding.GetMappingTableHash() in VNTextPatch
+static int GetVNTextPatchHash(wchar_t c, int bits)
+{
+    return (int)(((uint32_t)c * 0x9E3779B1u) >> (32 - bits));
+}
+
+static void Write(vector<BYTE>& file, uint32_t value, int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        file.push_back((BYTE)(value >> (i * 8)));
+    }
+}
+
+// SjisTunnelEncoding.GetMappingTable() in VNTextPatch
+static vector<BYTE> BuildMappingFile(const vector<wchar_t>& mappings)
+{
+    int reverseTableBits = 4;
+    while ((1 << reverseTableBits) < (int)mappings.size() * 2)
+    {
+        reverseTableBits++;
+    }
+
+    int reverseTableSize = 1 << reverseTableBits;
+    vector<WORD> reverseTable(reverseTableSize * 2);
+    for (int mappingIdx = 0; mappingIdx < (int)mappings.size(); mappingIdx++)
+    {
+        int entryIdx = GetVNTextPatchHash(mappings[mappingIdx], reverseTableBits);
+        while (reverseTable[entryIdx * 2 + 1] != 0)
+        {
+            entryIdx = (entryIdx + 1) & (reverseTableSize - 1);
+        }
+
+        reverseTable[entryIdx * 2] = (WORD)mappings[mappingIdx];
+        reverseTable[entryIdx * 2 + 1] = (WORD)(mappingIdx + 1);
+    }
+
+    int forwardTableOffset = 0x18;
+    int reverseTableOffset = (forwardTableOffset + (int)mappings.size() * 2 + 3) & ~3;
+
+    vector<BYTE> file;
+    Write(file, 0x58454A53, 4);
+    Write(file, 2, 4);
+    Write(file, mappings.size(), 4);
+    Write(file, reverseTableSize, 4);
+    Write(file, forwardTableOffset, 4);
+    Write(file, reverseTableOffset, 4);
+    for (wchar_t c : mappings)
+    {
+        Write(file, c, 2);
+    }
+
+    file.resize(reverseTableOffset);
+    for (WORD value : reverseTable)
+    {
+        Write(file, value, 2);
+    }
+    return file;
+}
+
+static void WriteMappingFile(const vector<BYTE>& file)
+{
+    ofstream stream("sjis_ext.bin", ios::binary | ios::trunc);
+    stream.write((const char*)file.data(), file.size());
+}
+
+static int GetReverseTableOffset(const vector<BYTE>& file)
+{
+    return file[0x14] | (file[0x15] << 8) | (file[0x16] << 16) | (file[0x17] << 24);
+}
+
+// The first used entry of the reverse table
+static int GetFirstReverseEntryOffset(const vector<BYTE>& file)
+{
+    int offset = GetReverseTableOffset(file);
+    while (file[offset + 2] == 0 && file[offset + 3] == 0)
+    {
+        offset += 4;
+    }
+    return offset;
+}
+
+static WORD GetTunnelCode(const string& encoded)
+{
+    return encoded.size() == 2 ? (WORD)(((BYTE)encoded[0] << 8) | (BYTE)encoded[1]) : 0;
+}
+
+// The characters from the file keep the codes VNTextPatch gave them, and new ones continue after them
+static void CheckConversions()
+{
+    for (int mappingIdx = 0; mappingIdx < NumFileChars + 100; mappingIdx++)
+    {
+        wstring text(1, GetTunneledChar(mappingIdx));
+        string encoded = SjisTunnelEncoding::Encode(text);
+        CHECK_EQUAL(GetVNTextPatchTunnelCode(mappingIdx), GetTunnelCode(encoded));
+        CHECK(SjisTunnelEncoding::Decode(encoded) == text);
+    }
+
+    CHECK(SjisTunnelEncoding::Encode(L"a\x3042") == "a\x82\xA0");
+    CHECK(SjisTunnelEncoding::Decode("a\x82\xA0") == L"a\x3042");
+}
+
+int main(int argc, char** argv)
+{
+    string testCase = argc > 1 ? argv[1] : "valid";
+
+    vector<wchar_t> mappings;
+    for (int i = 0; i < NumFileChars; i++)
+    {
+        mappings.push_back(GetTunneledChar(i));
+    }
+    vector<BYTE> file = BuildMappingFile(mappings);
+
+    if (testCase == "valid")
+    {
+        WriteMappingFile(file);
+        CheckConversions();
+        return TestUtil::TestResult();
+    }
+
+    if (testCase == "legacy")
+    {
+        // Version 1: just the forward table
+        WriteMappingFile(vector<BYTE>(file.begin() + 0x18, file.begin() + 0x18 + NumFileChars * 2));
+        CheckConversions();
+        return TestUtil::TestResult();
+    }
+
+    if (testCase == "version")
+    {
+        file[4] = 3;
+    }
+    else if (testCase == "truncated")
+    {
+        file.resize(file.size() - 2);
+    }
+    else if (testCase == "index")
+    {
+        // Points past the forward table
+        int offset = GetFirstReverseEntryOffset(file);
+        file[offset + 2] = (BYTE)((NumFileChars + 1) & 0xFF);
+        file[offset + 3] = (BYTE)((NumFileChars + 1) >> 8);
+    }
+    else if (testCase == "char")
+    {
+        // Points at a different character than the one it's stored for
+        int offset = GetFirstReverseEntryOffset(file);
+        file[offset] ^= 1;
+    }
+    else
+    {
+        fprintf(stderr, "Unknown test case: %s\n", testCase.c_str());
+        return 1;
+    }
+
+    WriteMappingFile(file);
+    SjisTunnelEncoding::Encode(L"a");
+    fprintf(stderr, "The damaged sjis_ext.bin was accepted\n");
+    return 1;
+}
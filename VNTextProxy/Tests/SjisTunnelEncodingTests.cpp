@@ -0,0 +1,171 @@
+// Races threads that encode overlapping sets of characters outside CP932, checking that every character ends up
+// with exactly one tunnel code, and that the table stays consistent once it runs full.
+#include "pch.h"
+
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "TestUtil.h"
+
+using namespace std;
+
+// 0x3B lead bytes times 58 usable trail bytes (SjisTunnelEncoding::MaxMappings)
+static constexpr int MaxMappings = 0x3B * 58;
+static constexpr int NumThreads = 8;
+
+// Hangul syllables: none of them are in CP932
+static wchar_t GetTunneledChar(int index)
+{
+    return (wchar_t)(0xAC00 + index);
+}
+
+static WORD GetTunnelCode(const string& encoded)
+{
+    return encoded.size() == 2 ? (WORD)(((BYTE)encoded[0] << 8) | (BYTE)encoded[1]) : 0;
+}
+
+// Every thread encodes the same characters in its own random order, mixed with text that doesn't need tunneling.
+// Each encoded character is decoded again right away, which checks that a slot is fully published before
+// its tunnel code can be handed out.
+static unordered_map<wchar_t, WORD> CheckConcurrentGrowth(int numChars)
+{
+    vector<unordered_map<wchar_t, WORD>> threadCodes(NumThreads);
+    atomic<int> numMismatches = 0;
+    vector<thread> threads;
+    for (int threadIdx = 0; threadIdx < NumThreads; threadIdx++)
+    {
+        threads.emplace_back([&, threadIdx]
+        {
+            vector<int> order(numChars);
+            for (int i = 0; i < numChars; i++)
+            {
+                order[i] = i;
+            }
+            shuffle(order.begin(), order.end(), mt19937(threadIdx));
+
+            for (int charIdx : order)
+            {
+                wchar_t c = GetTunneledChar(charIdx);
+                wstring text = wstring(L"ab") + c + L"\x3042";
+                string encoded = SjisTunnelEncoding::Encode(text);
+                if (encoded.size() != 6 || SjisTunnelEncoding::Decode(encoded) != text)
+                    numMismatches++;
+
+                threadCodes[threadIdx][c] = GetTunnelCode(encoded.substr(2, 2));
+            }
+        });
+    }
+
+    for (thread& thread : threads)
+    {
+        thread.join();
+    }
+    CHECK_EQUAL(0, numMismatches.load());
+
+    // All threads have to agree on the code of each character, and no two characters may share one
+    unordered_map<wchar_t, WORD> codes = threadCodes[0];
+    CHECK_EQUAL(numChars, (int)codes.size());
+    for (int threadIdx = 1; threadIdx < NumThreads; threadIdx++)
+    {
+        CHECK(threadCodes[threadIdx] == codes);
+    }
+
+    unordered_set<WORD> uniqueCodes;
+    for (auto [c, code] : codes)
+    {
+        CHECK(code != 0);
+        CHECK(uniqueCodes.insert(code).second);
+    }
+    return codes;
+}
+
+// Fills the table past its capacity from all threads at once. Exactly MaxMappings characters may get a code,
+// the others have to throw - and keep throwing rather than getting stuck as half-added.
+static void CheckLimit(const unordered_map<wchar_t, WORD>& existingCodes)
+{
+    int numExisting = existingCodes.size();
+    int numChars = MaxMappings - numExisting + 500;
+    vector<unordered_map<wchar_t, WORD>> threadCodes(NumThreads);
+    vector<unordered_set<wchar_t>> threadFailures(NumThreads);
+    vector<thread> threads;
+    for (int threadIdx = 0; threadIdx < NumThreads; threadIdx++)
+    {
+        threads.emplace_back([&, threadIdx]
+        {
+            vector<int> order(numChars);
+            for (int i = 0; i < numChars; i++)
+            {
+                order[i] = numExisting + i;
+            }
+            shuffle(order.begin(), order.end(), mt19937(100 + threadIdx));
+
+            for (int charIdx : order)
+            {
+                wchar_t c = GetTunneledChar(charIdx);
+                try
+                {
+                    threadCodes[threadIdx][c] = GetTunnelCode(SjisTunnelEncoding::Encode(wstring(1, c)));
+                }
+                catch (const runtime_error&)
+                {
+                    threadFailures[threadIdx].insert(c);
+                }
+            }
+        });
+    }
+
+    for (thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    // A character that one thread got a code for may have failed in an earlier attempt by another thread
+    // (when it lost the race for the last slots), but not the other way around
+    unordered_map<wchar_t, WORD> codes = existingCodes;
+    for (int threadIdx = 0; threadIdx < NumThreads; threadIdx++)
+    {
+        for (auto [c, code] : threadCodes[threadIdx])
+        {
+            auto [it, inserted] = codes.try_emplace(c, code);
+            CHECK(it->second == code);
+        }
+    }
+    CHECK_EQUAL(MaxMappings, (int)codes.size());
+
+    unordered_set<WORD> uniqueCodes;
+    for (auto [c, code] : codes)
+    {
+        CHECK(uniqueCodes.insert(code).second);
+        CHECK(SjisTunnelEncoding::Decode(SjisTunnelEncoding::Encode(wstring(1, c))) == wstring(1, c));
+    }
+
+    for (int charIdx = numExisting; charIdx < numExisting + numChars; charIdx++)
+    {
+        wchar_t c = GetTunneledChar(charIdx);
+        if (codes.contains(c))
+            continue;
+
+        bool threw = false;
+        try
+        {
+            SjisTunnelEncoding::Encode(wstring(1, c));
+        }
+        catch (const runtime_error&)
+        {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+}
+
+int main()
+{
+    // Characters CP932 has don't use up slots
+    CHECK(SjisTunnelEncoding::Encode(L"a\x3042") == "a\x82\xA0");
+
+    unordered_map<wchar_t, WORD> codes = CheckConcurrentGrowth(2000);
+    CheckLimit(codes);
+    return TestUtil::TestResult();
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Minimal helpers for the stand-alone Linux tests and benchmarks. A failed check is reported but doesn't stop the test,
+// so one run shows everything that's wrong; TestResult() then gives the exit code.
+namespace TestUtil
+{
+    inline int NumFailedChecks = 0;
+
+    inline void ReportFailure(const char* pFile, int line, const std::string& message)
+    {
+        fprintf(stderr, "%s(%d): check failed: %s\n", pFile, line, message.c_str());
+        NumFailedChecks++;
+    }
+
+    inline int TestResult()
+    {
+        if (NumFailedChecks != 0)
+        {
+            fprintf(stderr, "%d check(s) failed\n", NumFailedChecks);
+            return 1;
+        }
+
+        printf("All checks passed\n");
+        return 0;
+    }
+
+    // Runs func repeatedly for at least minSeconds (and at least once), and returns the fastest run in milliseconds
+    template<typename TFunc>
+    double MeasureBest(TFunc&& func, double minSeconds = 1.0)
+    {
+        using Clock = std::chrono::steady_clock;
+        double bestMs = 1e30;
+        Clock::time_point start = Clock::now();
+        do
+        {
+            Clock::time_point runStart = Clock::now();
+            func();
+            double runMs = std::chrono::duration<double, std::milli>(Clock::now() - runStart).count();
+            if (runMs < bestMs)
+                bestMs = runMs;
+        } while (std::chrono::duration<double>(Clock::now() - start).count() < minSeconds);
+        return bestMs;
+    }
+
+    // Reads a UTF-8 text file as lines of UTF-16 code units (which is what the hooks receive), exiting if it can't be read
+    inline std::vector<std::wstring> ReadUtf8Lines(const char* pPath)
+    {
+        std::ifstream file(pPath, std::ios::binary);
+        std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (text.empty())
+        {
+            fprintf(stderr, "Couldn't read %s\n", pPath);
+            exit(1);
+        }
+
+        std::vector<std::wstring> lines(1);
+        for (size_t i = 0; i < text.size(); )
+        {
+            unsigned char byte = text[i];
+            int length = byte < 0x80 ? 1 : byte < 0xE0 ? 2 : byte < 0xF0 ? 3 : 4;
+            unsigned int c = length == 1 ? byte : byte & (0xFF >> (length + 1));
+            for (int j = 1; j < length && i + j < text.size(); j++)
+            {
+                c = (c << 6) | (text[i + j] & 0x3F);
+            }
+            i += length;
+
+            if (c == '\n')
+            {
+                lines.emplace_back();
+            }
+            else if (c >= 0x10000)
+            {
+                c -= 0x10000;
+                lines.back() += (wchar_t)(0xD800 + (c >> 10));
+                lines.back() += (wchar_t)(0xDC00 + (c & 0x3FF));
+            }
+            else if (c != '\r')
+            {
+                lines.back() += (wchar_t)c;
+            }
+        }
+        return lines;
+    }
+
+    // Keeps the compiler from optimizing away a benchmark's result
+    template<typename T>
+    void Consume(const T& value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+}
+
+#define CHECK(condition) \
+    do { if (!(condition)) TestUtil::ReportFailure(__FILE__, __LINE__, #condition); } while (0)
+
+#define CHECK_EQUAL(expected, actual) \
+    do \
+    { \
+        auto&& checkExpected_ = (expected); \
+        auto&& checkActual_ = (actual); \
+        if (!(checkExpected_ == checkActual_)) \
+        { \
+            TestUtil::ReportFailure(__FILE__, __LINE__, std::string(#actual " == " #expected " (got ") + \
+                std::to_string((long long)checkActual_) + ", expected " + std::to_string((long long)checkExpected_) + ")"); \
+        } \
+    } while (0)
@@ -0,0 +1,224 @@
+// Deliberately doesn't include pch.h (and thus windows.h); see Cp932.h
+#include <algorithm>
+#include <bit>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define CP932_SSE2 1
+#include <immintrin.h>
+#endif
+
+#include "Cp932.h"
+#include "Cp932Table.h"
+
+using namespace std;
+
+static constexpr array<unsigned char, 256> BuildLeadByteRows()
+{
+    array<unsigned char, 256> rows{};
+    int row = 0;
+    for (int byte = 0; byte < 0x100; byte++)
+    {
+        bool isLeadByte = (byte >= 0x81 && byte < 0xA0) || (byte >= 0xE0 && byte < 0xFD);
+        rows[byte] = isLeadByte ? row++ : 0xFF;
+    }
+    return rows;
+}
+
+static constexpr array<wchar_t, 256> BuildSingleByteChars()
+{
+    array<wchar_t, 256> chars{};
+    for (int byte = 0; byte < 0x100; byte++)
+    {
+        if (byte <= 0x80)
+            chars[byte] = (wchar_t)byte;
+        else if (byte == 0xA0)
+            chars[byte] = 0xF8F0;
+        else if (byte >= 0xA1 && byte <= 0xDF)
+            chars[byte] = (wchar_t)(0xFF61 + (byte - 0xA1));
+        else if (byte >= 0xFD)
+            chars[byte] = (wchar_t)(0xF8F1 + (byte - 0xFD));
+        else
+            chars[byte] = 0x30FB;
+    }
+    return chars;
+}
+
+const array<unsigned char, 256> Cp932::LeadByteRows = BuildLeadByteRows();
+const array<wchar_t, 256> Cp932::SingleByteChars = BuildSingleByteChars();
+
+bool Cp932::IsLeadByte(unsigned char byte)
+{
+    return LeadByteRows[byte] != NoLeadByteRow;
+}
+
+wchar_t Cp932::DecodeSingleByte(unsigned char byte)
+{
+    return SingleByteChars[byte];
+}
+
+wchar_t Cp932::DecodeDoubleByte(unsigned char leadByte, unsigned char trailByte)
+{
+    unsigned char row = LeadByteRows[leadByte];
+    return row != NoLeadByteRow ? (wchar_t)Cp932DoubleByteTable[row][trailByte] : SingleByteChars[leadByte];
+}
+
+int Cp932::Decode(const char* pText, int numBytes, wchar_t* pOutput, int outputSize, int& numBytesRead)
+{
+    return Decode(pText, numBytes, pOutput, outputSize, numBytesRead, nullptr);
+}
+
+int Cp932::Decode(const char* pText, int numBytes, wchar_t* pOutput, int outputSize, int& numBytesRead, LowTrailByteDecoder pDecodeLowTrailByte)
+{
+    const unsigned char* pInputStart = (const unsigned char*)pText;
+    const unsigned char* pInput = pInputStart;
+    const unsigned char* pInputEnd = pInput + numBytes;
+    wchar_t* pOutputStart = pOutput;
+    wchar_t* pOutputEnd = pOutput + outputSize;
+    while (pInput < pInputEnd && pOutput < pOutputEnd)
+    {
+        unsigned char byte = *pInput;
+        if (byte < 0x80)
+        {
+            int numAscii = CopyAscii(pInput, min(pInputEnd - pInput, pOutputEnd - pOutput), pOutput);
+            pInput += numAscii;
+            pOutput += numAscii;
+            continue;
+        }
+
+        unsigned char row = LeadByteRows[byte];
+        if (row == NoLeadByteRow)
+        {
+            *pOutput++ = SingleByteChars[byte];
+            pInput++;
+            continue;
+        }
+
+        if (pInput + 1 == pInputEnd || pInput[1] == 0)
+            break;
+
+        unsigned char trailByte = pInput[1];
+        wchar_t c = L'\0';
+        if (trailByte < MinTrailByte && pDecodeLowTrailByte != nullptr)
+            c = pDecodeLowTrailByte(row, trailByte);
+
+        *pOutput++ = c != L'\0' ? c : (wchar_t)Cp932DoubleByteTable[row][trailByte];
+        pInput += 2;
+    }
+
+    numBytesRead = pInput - pInputStart;
+    return pOutput - pOutputStart;
+}
+
+int Cp932::Decode(const char* pText, int numBytes, wchar_t* pOutput)
+{
+    int numBytesRead;
+    return Decode(pText, numBytes, pOutput, numBytes, numBytesRead);
+}
+
+int Cp932::GetDecodedLength(const char* pText, int numBytes)
+{
+    const unsigned char* pInput = (const unsigned char*)pText;
+    const unsigned char* pInputEnd = pInput + numBytes;
+    int numChars = 0;
+    while (pInput < pInputEnd)
+    {
+        unsigned char byte = *pInput;
+        if (byte < 0x80)
+        {
+            int numAscii = CountAscii(pInput, pInputEnd - pInput);
+            pInput += numAscii;
+            numChars += numAscii;
+            continue;
+        }
+
+        if (LeadByteRows[byte] == NoLeadByteRow)
+        {
+            pInput++;
+            numChars++;
+            continue;
+        }
+
+        if (pInput + 1 == pInputEnd || pInput[1] == 0)
+            break;
+
+        pInput += 2;
+        numChars++;
+    }
+    return numChars;
+}
+
+#if CP932_SSE2
+static void StoreWidened(__m128i bytes, wchar_t* pOutput)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i low = _mm_unpacklo_epi8(bytes, zero);
+    __m128i high = _mm_unpackhi_epi8(bytes, zero);
+    if constexpr (sizeof(wchar_t) == 2)
+    {
+        _mm_storeu_si128((__m128i*)pOutput, low);
+        _mm_storeu_si128((__m128i*)(pOutput + 8), high);
+    }
+    else
+    {
+        _mm_storeu_si128((__m128i*)pOutput, _mm_unpacklo_epi16(low, zero));
+        _mm_storeu_si128((__m128i*)(pOutput + 4), _mm_unpackhi_epi16(low, zero));
+        _mm_storeu_si128((__m128i*)(pOutput + 8), _mm_unpacklo_epi16(high, zero));
+        _mm_storeu_si128((__m128i*)(pOutput + 12), _mm_unpackhi_epi16(high, zero));
+    }
+}
+#endif
+
+int Cp932::CopyAscii(const unsigned char* pText, int numBytes, wchar_t* pOutput)
+{
+    // ASCII maps to itself, so runs of it can be widened 16/32 bytes at a time. A block may contain
+    // non-ASCII bytes after the run; those get written too, but are overwritten by the caller afterwards.
+    int i = 0;
+#if CP932_SSE2
+#if defined(__AVX2__)
+    if constexpr (sizeof(wchar_t) == 2)
+    {
+        for (; i + 32 <= numBytes; i += 32)
+        {
+            __m256i bytes = _mm256_loadu_si256((const __m256i*)(pText + i));
+            unsigned int nonAsciiMask = (unsigned int)_mm256_movemask_epi8(bytes);
+            if (nonAsciiMask != 0)
+                break;
+
+            _mm256_storeu_si256((__m256i*)(pOutput + i), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes)));
+            _mm256_storeu_si256((__m256i*)(pOutput + i + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1)));
+        }
+    }
+#endif
+    for (; i + 16 <= numBytes; i += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(pText + i));
+        unsigned int nonAsciiMask = (unsigned int)_mm_movemask_epi8(bytes);
+        StoreWidened(bytes, pOutput + i);
+        if (nonAsciiMask != 0)
+            return i + countr_zero(nonAsciiMask);
+    }
+#endif
+    for (; i < numBytes && pText[i] < 0x80; i++)
+    {
+        pOutput[i] = (wchar_t)pText[i];
+    }
+    return i;
+}
+
+int Cp932::CountAscii(const unsigned char* pText, int numBytes)
+{
+    int i = 0;
+#if CP932_SSE2
+    for (; i + 16 <= numBytes; i += 16)
+    {
+        unsigned int nonAsciiMask = (unsigned int)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(pText + i)));
+        if (nonAsciiMask != 0)
+            return i + countr_zero(nonAsciiMask);
+    }
+#endif
+    while (i < numBytes && pText[i] < 0x80)
+    {
+        i++;
+    }
+    return i;
+}
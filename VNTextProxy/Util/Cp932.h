@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+
+// Table-driven CP932 (Shift-JIS) decoder that gives the same results as MultiByteToWideChar(932, 0, ...).
+// Doesn't use any Win32 functions so it can be built and checked outside of the game as well.
+class Cp932
+{
+public:
+    // Lead bytes are numbered 0-59 in byte order (0x81-0x9F, then 0xE0-0xFC). CP932 doesn't define any double-byte
+    // characters with a trail byte below 0x40, so callers can give those a meaning of their own (see SjisTunnelEncoding).
+    static constexpr int NumLeadByteRows = 60;
+    static constexpr unsigned char MinTrailByte = 0x40;
+
+    // Receives the lead byte row and the trail byte (< MinTrailByte) and returns the decoded character,
+    // or '\0' to decode the sequence like MultiByteToWideChar() does.
+    typedef wchar_t (*LowTrailByteDecoder)(int leadByteRow, unsigned char trailByte);
+
+    static bool             IsLeadByte              (unsigned char byte);
+    static wchar_t          DecodeSingleByte        (unsigned char byte);
+    static wchar_t          DecodeDoubleByte        (unsigned char leadByte, unsigned char trailByte);
+
+    // Decodes numBytes bytes into pOutput, writing at most outputSize characters. numBytesRead receives
+    // the number of input bytes that were consumed. Stops early if the input ends in the middle of a
+    // double-byte character or if a lead byte is followed by '\0'.
+    // Returns the number of characters written.
+    static int              Decode                  (const char* pText, int numBytes, wchar_t* pOutput, int outputSize, int& numBytesRead);
+    static int              Decode                  (const char* pText, int numBytes, wchar_t* pOutput, int outputSize, int& numBytesRead, LowTrailByteDecoder pDecodeLowTrailByte);
+
+    // Same as above for an output buffer that has room for numBytes characters (the most a CP932 string can decode to).
+    static int              Decode                  (const char* pText, int numBytes, wchar_t* pOutput);
+
+    // Returns the number of characters Decode() would produce, without writing them anywhere.
+    static int              GetDecodedLength        (const char* pText, int numBytes);
+
+private:
+    static int              CopyAscii               (const unsigned char* pText, int numBytes, wchar_t* pOutput);
+    static int              CountAscii              (const unsigned char* pText, int numBytes);
+
+    static constexpr unsigned char NoLeadByteRow = 0xFF;
+    static const std::array<unsigned char, 256> LeadByteRows;
+    static const std::array<wchar_t, 256> SingleByteChars;
+};
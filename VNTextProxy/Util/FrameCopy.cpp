@@ -0,0 +1,29 @@
+// Deliberately doesn't include pch.h (and thus windows.h); see FrameCopy.h
+#include <cstring>
+
+#include "FrameCopy.h"
+
+using namespace std;
+
+void FrameCopy::CopyRows(void* pDest, int destPitch, const void* pSource, int sourcePitch, int rowBytes, int numRows)
+{
+    if (rowBytes <= 0 || numRows <= 0)
+        return;
+
+    // Unpadded on both sides: the whole frame is one contiguous block, which lets memcpy pick its
+    // large-copy strategy (non-temporal stores) instead of restarting for every row
+    if (destPitch == rowBytes && sourcePitch == rowBytes)
+    {
+        memcpy(pDest, pSource, (size_t)rowBytes * numRows);
+        return;
+    }
+
+    unsigned char* pDestRow = (unsigned char*)pDest;
+    const unsigned char* pSourceRow = (const unsigned char*)pSource;
+    for (int y = 0; y < numRows; y++)
+    {
+        memcpy(pDestRow, pSourceRow, rowBytes);
+        pDestRow += destPitch;
+        pSourceRow += sourcePitch;
+    }
+}
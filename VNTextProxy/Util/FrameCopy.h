@@ -0,0 +1,11 @@
+#pragma once
+
+// Copies frame pixels between two pitched buffers, such as a locked D3D9 surface and a mapped D3D11 texture.
+// Doesn't use any Win32 functions so it can be built and checked outside of the game as well.
+class FrameCopy
+{
+public:
+    // Copies numRows rows of rowBytes bytes each. The pitches are the distances in bytes between the starts of
+    // two consecutive rows and may be larger than rowBytes (drivers tend to pad rows to some alignment).
+    static void             CopyRows                (void* pDest, int destPitch, const void* pSource, int sourcePitch, int rowBytes, int numRows);
+};
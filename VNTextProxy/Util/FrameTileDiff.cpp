@@ -0,0 +1,196 @@
+// Deliberately doesn't include pch.h (and thus windows.h); see FrameTileDiff.h
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define FRAMETILEDIFF_SSE2 1
+#include <immintrin.h>
+#endif
+
+#include "FrameTileDiff.h"
+
+using namespace std;
+
+// One key per 64-bit word position within a tile, so that the same pixels in a different place hash differently
+struct TileKeys
+{
+    alignas(16) uint64_t Words[FrameTileDiff::TileSize][FrameTileDiff::TileSize * 4 / 8];
+};
+
+static constexpr TileKeys BuildTileKeys()
+{
+    // splitmix64
+    TileKeys keys{};
+    uint64_t state = 0x243F6A8885A308D3ULL;
+    for (int y = 0; y < FrameTileDiff::TileSize; y++)
+    {
+        for (int i = 0; i < FrameTileDiff::TileSize * 4 / 8; i++)
+        {
+            state += 0x9E3779B97F4A7C15ULL;
+            uint64_t z = state;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            keys.Words[y][i] = z ^ (z >> 31);
+        }
+    }
+    return keys;
+}
+
+static constexpr TileKeys Keys = BuildTileKeys();
+
+// Same accumulation step as XXH3: the word is added in together with the product of the two halves of the keyed word
+static uint64_t Accumulate(uint64_t word, uint64_t key)
+{
+    uint64_t keyed = word ^ key;
+    return word + (keyed & 0xFFFFFFFF) * (keyed >> 32);
+}
+
+void FrameTileDiff::Reset(int width, int height)
+{
+    _width = width;
+    _height = height;
+    _tilesX = (width + TileSize - 1) / TileSize;
+    _tilesY = (height + TileSize - 1) / TileSize;
+    _hasPreviousFrame = false;
+    _hashes.assign(_tilesX * _tilesY, 0);
+    _dirtyTiles.assign(_tilesX * _tilesY, false);
+    _dirtyRects.clear();
+}
+
+int FrameTileDiff::Update(const void* pPixels, int pitch)
+{
+    const unsigned char* pFrame = (const unsigned char*)pPixels;
+    int numDirtyTiles = 0;
+    for (int tileY = 0; tileY < _tilesY; tileY++)
+    {
+        int y = tileY * TileSize;
+        int numRows = min(TileSize, _height - y);
+        for (int tileX = 0; tileX < _tilesX; tileX++)
+        {
+            int x = tileX * TileSize;
+            uint64_t hash = HashTile(pFrame + (size_t)y * pitch + x * 4, pitch, min(TileSize, _width - x) * 4, numRows);
+
+            int index = tileY * _tilesX + tileX;
+            bool dirty = !_hasPreviousFrame || hash != _hashes[index];
+            _hashes[index] = hash;
+            _dirtyTiles[index] = dirty;
+            if (dirty)
+                numDirtyTiles++;
+        }
+    }
+
+    _hasPreviousFrame = true;
+    CollectDirtyRects();
+    return numDirtyTiles;
+}
+
+void FrameTileDiff::CollectDirtyRects()
+{
+    _dirtyRects.clear();
+    for (int tileY = 0; tileY < _tilesY; tileY++)
+    {
+        int tileX = 0;
+        while (tileX < _tilesX)
+        {
+            if (!_dirtyTiles[tileY * _tilesX + tileX])
+            {
+                tileX++;
+                continue;
+            }
+
+            int runStart = tileX;
+            while (tileX < _tilesX && _dirtyTiles[tileY * _tilesX + tileX])
+            {
+                tileX++;
+            }
+
+            Rect run;
+            run.X = runStart * TileSize;
+            run.Y = tileY * TileSize;
+            run.Width = min(tileX * TileSize, _width) - run.X;
+            run.Height = min(run.Y + TileSize, _height) - run.Y;
+
+            // Extend the rectangle above if it spans exactly the same columns
+            auto above = find_if(_dirtyRects.begin(), _dirtyRects.end(), [&](const Rect& rect)
+            {
+                return rect.X == run.X && rect.Width == run.Width && rect.Y + rect.Height == run.Y;
+            });
+            if (above != _dirtyRects.end())
+                above->Height += run.Height;
+            else
+                _dirtyRects.push_back(run);
+        }
+    }
+}
+
+const vector<FrameTileDiff::Rect>& FrameTileDiff::GetDirtyRects() const
+{
+    return _dirtyRects;
+}
+
+int FrameTileDiff::GetWidth() const
+{
+    return _width;
+}
+
+int FrameTileDiff::GetHeight() const
+{
+    return _height;
+}
+
+int FrameTileDiff::GetNumTiles() const
+{
+    return _tilesX * _tilesY;
+}
+
+uint64_t FrameTileDiff::HashTile(const unsigned char* pPixels, int pitch, int rowBytes, int numRows)
+{
+    // Even and odd words go into separate accumulators, which lets SSE2 process two words at a time
+    uint64_t acc[2] = { 0x9E3779B185EBCA87ULL, 0xC2B2AE3D27D4EB4FULL };
+#if FRAMETILEDIFF_SSE2
+    __m128i accVec = _mm_setzero_si128();
+#endif
+    for (int y = 0; y < numRows; y++)
+    {
+        const unsigned char* pRow = pPixels + (size_t)y * pitch;
+        const uint64_t* pKeys = Keys.Words[y];
+        int i = 0;
+#if FRAMETILEDIFF_SSE2
+        for (; i + 16 <= rowBytes; i += 16)
+        {
+            __m128i words = _mm_loadu_si128((const __m128i*)(pRow + i));
+            __m128i keyed = _mm_xor_si128(words, _mm_load_si128((const __m128i*)(pKeys + i / 8)));
+            __m128i product = _mm_mul_epu32(keyed, _mm_srli_epi64(keyed, 32));
+            accVec = _mm_add_epi64(accVec, _mm_add_epi64(words, product));
+        }
+#endif
+        for (; i + 8 <= rowBytes; i += 8)
+        {
+            uint64_t word;
+            memcpy(&word, pRow + i, 8);
+            acc[(i / 8) & 1] += Accumulate(word, pKeys[i / 8]);
+        }
+        if (i < rowBytes)
+        {
+            uint32_t pixel;
+            memcpy(&pixel, pRow + i, 4);
+            acc[(i / 8) & 1] += Accumulate(pixel, pKeys[i / 8]);
+        }
+    }
+
+#if FRAMETILEDIFF_SSE2
+    uint64_t vecAcc[2];
+    _mm_storeu_si128((__m128i*)vecAcc, accVec);
+    acc[0] += vecAcc[0];
+    acc[1] += vecAcc[1];
+#endif
+
+    // Fold the accumulators and finish with MurmurHash3's fmix64
+    uint64_t hash = acc[0] ^ ((acc[1] << 29) | (acc[1] >> 35)) * 0x9E3779B97F4A7C15ULL;
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
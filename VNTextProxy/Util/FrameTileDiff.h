@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Finds the parts of a 32-bit frame that changed since the previous one by hashing it in square tiles.
+// Doesn't use any Win32 functions so it can be built and checked outside of the game as well.
+class FrameTileDiff
+{
+public:
+    static constexpr int TileSize = 32;
+
+    struct Rect
+    {
+        int X;
+        int Y;
+        int Width;
+        int Height;
+    };
+
+    // Sets the frame size and forgets the previous frame, so the next Update() reports every tile as changed
+    void                    Reset                   (int width, int height);
+
+    // Hashes the tiles of a frame (4 bytes per pixel, pitch bytes between the starts of two rows) and compares
+    // them against those of the previous frame. Returns the number of tiles that changed.
+    int                     Update                  (const void* pPixels, int pitch);
+
+    // Pixel rectangles covering the tiles that changed in the last Update(), clipped to the frame. Changed tiles
+    // next to each other in a tile row are merged, and so are runs in consecutive tile rows that span the same columns.
+    const std::vector<Rect>& GetDirtyRects          () const;
+
+    int                     GetWidth                () const;
+    int                     GetHeight               () const;
+    int                     GetNumTiles             () const;
+
+    // Hashes a tile of up to TileSize x TileSize pixels; rowBytes must be a multiple of 4 no larger than TileSize * 4
+    static uint64_t         HashTile                (const unsigned char* pPixels, int pitch, int rowBytes, int numRows);
+
+private:
+    void                    CollectDirtyRects       ();
+
+    int _width = 0;
+    int _height = 0;
+    int _tilesX = 0;
+    int _tilesY = 0;
+    bool _hasPreviousFrame = false;
+    std::vector<uint64_t> _hashes;
+    std::vector<bool> _dirtyTiles;
+    std::vector<Rect> _dirtyRects;
+};
@@ -1,58 +1,198 @@
 #include "pch.h"
 
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define MEMORYUTIL_SSE2 1
+#include <immintrin.h>
+#endif
+
 using namespace std;
 
 void* MemoryUtil::FindData(const void* pHaystack, int haystackLength, const void* pNeedle, int needleLength)
 {
-    BYTE* pTest = (BYTE*)pHaystack;
-    BYTE* pEnd = pTest + haystackLength - needleLength;
-    for (; pTest <= pEnd; pTest++)
+    return ScanData((const BYTE*)pHaystack, haystackLength, (const BYTE*)pNeedle, nullptr, needleLength);
+}
+
+void* MemoryUtil::FindData(const void* pHaystack, int haystackLength, const void* pNeedle, const void* pNeedleMask, int needleLength)
+{
+    return ScanData((const BYTE*)pHaystack, haystackLength, (const BYTE*)pNeedle, (const BYTE*)pNeedleMask, needleLength);
+}
+
+void* MemoryUtil::ScanData(const BYTE* pHaystack, int haystackLength, const BYTE* pNeedle, const BYTE* pNeedleMask, int needleLength)
+{
+    // Rather than comparing the whole needle at every position, compare two of its bytes at 16/32 positions at once
+    // and only do the full comparison where both of them match. The bytes are picked to be rare in executable images
+    // so that there are as few of those candidates as possible.
+    int numPositions = haystackLength - needleLength + 1;
+    if (needleLength <= 0 || numPositions <= 0)
+        return needleLength <= 0 ? (void*)pHaystack : nullptr;
+
+    ScanAnchor anchors[2];
+    if (!SelectScanAnchors(pNeedle, pNeedleMask, needleLength, anchors))
+        return (void*)pHaystack;
+
+    int position = 0;
+#if MEMORYUTIL_SSE2
+#if defined(__AVX2__)
+    __m256i value1Avx = _mm256_set1_epi8((char)anchors[0].Value);
+    __m256i mask1Avx = _mm256_set1_epi8((char)anchors[0].Mask);
+    __m256i value2Avx = _mm256_set1_epi8((char)anchors[1].Value);
+    __m256i mask2Avx = _mm256_set1_epi8((char)anchors[1].Mask);
+    for (; position + 32 <= numPositions; position += 32)
+    {
+        __m256i bytes1 = _mm256_loadu_si256((const __m256i*)(pHaystack + position + anchors[0].Offset));
+        __m256i bytes2 = _mm256_loadu_si256((const __m256i*)(pHaystack + position + anchors[1].Offset));
+        __m256i matches1 = _mm256_cmpeq_epi8(_mm256_and_si256(bytes1, mask1Avx), value1Avx);
+        __m256i matches2 = _mm256_cmpeq_epi8(_mm256_and_si256(bytes2, mask2Avx), value2Avx);
+        unsigned int candidates = (unsigned int)_mm256_movemask_epi8(_mm256_and_si256(matches1, matches2));
+        for (; candidates != 0; candidates &= candidates - 1)
+        {
+            const BYTE* pTest = pHaystack + position + countr_zero(candidates);
+            if (MatchesAt(pTest, pNeedle, pNeedleMask, needleLength))
+                return (void*)pTest;
+        }
+    }
+#endif
+    __m128i value1 = _mm_set1_epi8((char)anchors[0].Value);
+    __m128i mask1 = _mm_set1_epi8((char)anchors[0].Mask);
+    __m128i value2 = _mm_set1_epi8((char)anchors[1].Value);
+    __m128i mask2 = _mm_set1_epi8((char)anchors[1].Mask);
+    for (; position + 16 <= numPositions; position += 16)
     {
-        if (memcmp(pTest, pNeedle, needleLength) == 0)
-            return pTest;
+        __m128i bytes1 = _mm_loadu_si128((const __m128i*)(pHaystack + position + anchors[0].Offset));
+        __m128i bytes2 = _mm_loadu_si128((const __m128i*)(pHaystack + position + anchors[1].Offset));
+        __m128i matches1 = _mm_cmpeq_epi8(_mm_and_si128(bytes1, mask1), value1);
+        __m128i matches2 = _mm_cmpeq_epi8(_mm_and_si128(bytes2, mask2), value2);
+        unsigned int candidates = (unsigned int)_mm_movemask_epi8(_mm_and_si128(matches1, matches2));
+        for (; candidates != 0; candidates &= candidates - 1)
+        {
+            const BYTE* pTest = pHaystack + position + countr_zero(candidates);
+            if (MatchesAt(pTest, pNeedle, pNeedleMask, needleLength))
+                return (void*)pTest;
+        }
+    }
+#endif
+    for (; position < numPositions; position++)
+    {
+        const BYTE* pTest = pHaystack + position;
+        if ((pTest[anchors[0].Offset] & anchors[0].Mask) == anchors[0].Value &&
+            (pTest[anchors[1].Offset] & anchors[1].Mask) == anchors[1].Value &&
+            MatchesAt(pTest, pNeedle, pNeedleMask, needleLength))
+        {
+            return (void*)pTest;
+        }
     }
     return nullptr;
 }
 
-void* MemoryUtil::FindData(const void* pHaystack, int haystackLength, const void* pNeedle, const void* pNeedleMask, int needleLength)
+bool MemoryUtil::SelectScanAnchors(const BYTE* pNeedle, const BYTE* pNeedleMask, int needleLength, ScanAnchor* pAnchors)
 {
-    BYTE* pTest = (BYTE*)pHaystack;
-    BYTE* pEnd = pTest + haystackLength - needleLength;
-    for (; pTest <= pEnd; pTest++)
+    int bestOffset = GetRarestByteOffset(pNeedle, pNeedleMask, needleLength);
+    if (bestOffset < 0)
+        return false;
+
+    // The second anchor should preferably have a different value, since two equal bytes tend to come in runs
+    int secondOffset = bestOffset;
+    int secondCost = INT_MAX;
+    for (int offset = 0; offset < needleLength; offset++)
     {
-        int offset = 0;
-        bool failed = false;
-        for (; offset < (needleLength & ~3); offset += 4)
+        if (offset == bestOffset)
+            continue;
+
+        int cost = GetAnchorCost(pNeedle, pNeedleMask, offset);
+        if (cost != INT_MAX && pNeedle[offset] == pNeedle[bestOffset])
+            cost++;
+
+        if (cost < secondCost)
         {
-            DWORD test   = *(DWORD*)(pTest + offset);
-            DWORD needle = *(DWORD*)((BYTE*)pNeedle + offset);
-            DWORD mask   = *(DWORD*)((BYTE*)pNeedleMask + offset);
-            if ((test & mask) != needle)
-            {
-                failed = true;
-                break;
-            }
+            secondOffset = offset;
+            secondCost = cost;
         }
-        if (failed)
-            continue;
+    }
 
-        for (; offset < needleLength; offset++)
+    for (int i = 0; i < 2; i++)
+    {
+        int offset = i == 0 ? bestOffset : secondOffset;
+        pAnchors[i].Offset = offset;
+        pAnchors[i].Mask = pNeedleMask != nullptr ? pNeedleMask[offset] : 0xFF;
+        pAnchors[i].Value = pNeedle[offset] & pAnchors[i].Mask;
+    }
+    return true;
+}
+
+int MemoryUtil::GetRarestByteOffset(const void* pNeedle, const void* pNeedleMask, int needleLength)
+{
+    int bestOffset = -1;
+    int bestCost = INT_MAX;
+    for (int offset = 0; offset < needleLength; offset++)
+    {
+        int cost = GetAnchorCost((const BYTE*)pNeedle, (const BYTE*)pNeedleMask, offset);
+        if (cost < bestCost)
         {
-            BYTE test   = pTest[offset];
-            BYTE needle = *((BYTE*)pNeedle + offset);
-            BYTE mask   = *((BYTE*)pNeedleMask + offset);
-            if ((test & mask) != needle)
-            {
-                failed = true;
-                break;
-            }
+            bestOffset = offset;
+            bestCost = cost;
         }
-        if (failed)
-            continue;
+    }
+    return bestOffset;
+}
 
-        return pTest;
+int MemoryUtil::GetAnchorCost(const BYTE* pNeedle, const BYTE* pNeedleMask, int offset)
+{
+    // Lower is better: fully specified bytes that don't show up much in code or data sections
+    BYTE mask = pNeedleMask != nullptr ? pNeedleMask[offset] : 0xFF;
+    if (mask == 0)
+        return INT_MAX;
+
+    int cost = mask == 0xFF ? 0 : 8;
+    switch (pNeedle[offset] & mask)
+    {
+        case 0x00:
+            cost += 4;
+            break;
+
+        case 0xFF:
+        case 0xCC:
+            cost += 3;
+            break;
+
+        case 0x8B:
+        case 0x89:
+        case 0x48:
+        case 0x01:
+        case 0x24:
+        case 0x90:
+        case 0xE8:
+        case 0x0F:
+        case 0x30:
+            cost += 2;
+            break;
     }
-    return nullptr;
+    return cost;
+}
+
+bool MemoryUtil::MatchesAt(const BYTE* pTest, const BYTE* pNeedle, const BYTE* pNeedleMask, int needleLength)
+{
+    if (pNeedleMask == nullptr)
+        return memcmp(pTest, pNeedle, needleLength) == 0;
+
+    int offset = 0;
+    for (; offset < (needleLength & ~3); offset += 4)
+    {
+        DWORD test   = *(DWORD*)(pTest + offset);
+        DWORD needle = *(DWORD*)(pNeedle + offset);
+        DWORD mask   = *(DWORD*)(pNeedleMask + offset);
+        if ((test & mask) != needle)
+            return false;
+    }
+
+    for (; offset < needleLength; offset++)
+    {
+        BYTE test   = pTest[offset];
+        BYTE needle = pNeedle[offset];
+        BYTE mask   = pNeedleMask[offset];
+        if ((test & mask) != needle)
+            return false;
+    }
+    return true;
 }
 
 void MemoryUtil::WritePointer(void** ptr, void* value)
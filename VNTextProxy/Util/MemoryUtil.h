@@ -6,4 +6,21 @@ public:
     static void*            FindData                (const void* pHaystack, int haystackLength, const void* pNeedle, int needleLength);
     static void*            FindData                (const void* pHaystack, int haystackLength, const void* pNeedle, const void* pNeedleMask, int needleLength);
     static void             WritePointer            (void** ptr, void* value);
+
+    // Returns the offset of the needle byte that's least likely to show up in an executable image
+    // (ignoring bytes that are masked out entirely), or -1 if the whole needle is masked out.
+    static int              GetRarestByteOffset     (const void* pNeedle, const void* pNeedleMask, int needleLength);
+
+private:
+    struct ScanAnchor
+    {
+        int Offset;
+        BYTE Value;
+        BYTE Mask;
+    };
+
+    static void*            ScanData                (const BYTE* pHaystack, int haystackLength, const BYTE* pNeedle, const BYTE* pNeedleMask, int needleLength);
+    static bool             SelectScanAnchors       (const BYTE* pNeedle, const BYTE* pNeedleMask, int needleLength, ScanAnchor* pAnchors);
+    static int              GetAnchorCost           (const BYTE* pNeedle, const BYTE* pNeedleMask, int offset);
+    static bool             MatchesAt               (const BYTE* pTest, const BYTE* pNeedle, const BYTE* pNeedleMask, int needleLength);
 };
@@ -67,6 +67,7 @@ void RuntimeConfig::Load()
         _proportionalLineWidth = config.at("proportionalLineWidth").get<int>();
         _maxLineWidth = config.at("maxLineWidth").get<int>();
         _numLinesWarnThreshold = config.at("numLinesWarnThreshold").get<int>();
+        _frameQueueDepth = std::clamp(config.value("frameQueueDepth", 2), 1, MaxFrameQueueDepth);
 
         // Read graphicsMode string (required, no default)
         if (!config.contains("graphicsMode")) {
@@ -108,6 +109,7 @@ void RuntimeConfig::Load()
         _pillarboxedFullscreen ? (_directX11Upscaling ? "dx11" : "dx9") : "raw",
         _pillarboxedFullscreen ? "true" : "false",
         _directX11Upscaling ? "true" : "false");
+    proxy_log(LogCategory::HOOKS, "  frameQueueDepth: %d", _frameQueueDepth);
     proxy_log(LogCategory::HOOKS, "  customFontFilename: %ls", _customFontFilename.c_str());
     proxy_log(LogCategory::HOOKS, "  monospaceFontFilename: %ls", _monospaceFontFilename.c_str());
     proxy_log(LogCategory::HOOKS, "  fontHeightIncrease: %d", _fontHeightIncrease);
@@ -122,6 +124,7 @@ bool RuntimeConfig::DebugLogging() { return _debugLogging; }
 bool RuntimeConfig::EnableFontSubstitution() { return _enableFontSubstitution; }
 bool RuntimeConfig::PillarboxedFullscreen() { return _pillarboxedFullscreen; }
 bool RuntimeConfig::DirectX11Upscaling() { return _directX11Upscaling; }
+int RuntimeConfig::FrameQueueDepth() { return _frameQueueDepth; }
 const std::wstring& RuntimeConfig::CustomFontFilename() { return _customFontFilename; }
 const std::wstring& RuntimeConfig::MonospaceFontFilename() { return _monospaceFontFilename; }
 int RuntimeConfig::FontHeightIncrease() { return _fontHeightIncrease; }
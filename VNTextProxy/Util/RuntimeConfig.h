@@ -6,6 +6,9 @@
 // Call RuntimeConfig::Load() early in initialization before accessing any values.
 class RuntimeConfig {
 public:
+    // Upper limit for frameQueueDepth
+    static constexpr int MaxFrameQueueDepth = 4;
+
     // Loads configuration from VNTranslationToolsConstants.json
     // Shows MessageBox and exits on error (file not found or parse error)
     static void Load();
@@ -15,6 +18,7 @@ public:
     static bool EnableFontSubstitution();
     static bool PillarboxedFullscreen();
     static bool DirectX11Upscaling();
+    static int FrameQueueDepth();
     static const std::wstring& CustomFontFilename();
     static const std::wstring& MonospaceFontFilename();
     static int FontHeightIncrease();
@@ -30,6 +34,7 @@ private:
     static inline bool _enableFontSubstitution;
     static inline bool _pillarboxedFullscreen;
     static inline bool _directX11Upscaling;
+    static inline int _frameQueueDepth;
     static inline std::wstring _customFontFilename;
     static inline std::wstring _monospaceFontFilename;
     static inline int _fontHeightIncrease;
@@ -94,19 +94,14 @@ int Win32AToWAdapter::MultiByteToWideCharHook(UINT codePage, DWORD flags, LPCCH
     if (codePage != CP_ACP && codePage != CP_THREAD_ACP && codePage != 932)
         return MultiByteToWideChar(codePage, flags, lpMultiByteStr, cbMultiByte, lpWideCharStr, cchWideChar);
 
-    wstring wstr = SjisTunnelEncoding::Decode(lpMultiByteStr, cbMultiByte);
-    int numWchars = wstr.size();
-    if (cbMultiByte < 0)
-        numWchars++;
+    if (cchWideChar <= 0)
+        return SjisTunnelEncoding::GetDecodedLength(lpMultiByteStr, cbMultiByte);
 
-    if (cchWideChar > 0)
+    int numWchars = SjisTunnelEncoding::Decode(lpMultiByteStr, cbMultiByte, lpWideCharStr, cchWideChar);
+    if (numWchars > cchWideChar)
     {
-        memcpy(lpWideCharStr, wstr.c_str(), min(numWchars, cchWideChar) * sizeof(wchar_t));
-        if (cchWideChar < numWchars)
-        {
-            SetLastError(ERROR_INSUFFICIENT_BUFFER);
-            return 0;
-        }
+        SetLastError(ERROR_INSUFFICIENT_BUFFER);
+        return 0;
     }
 
     return numWchars;
@@ -120,19 +115,14 @@ int Win32AToWAdapter::WideCharToMultiByteHook(UINT codePage, DWORD flags, LPCWCH
     if (lpUsedDefaultChar != nullptr)
         *lpUsedDefaultChar = false;
 
-    string str = SjisTunnelEncoding::Encode(lpWideCharStr, cchWideChar);
-    int numChars = str.size();
-    if (cchWideChar < 0)
-        numChars++;
+    if (cbMultiByte <= 0)
+        return SjisTunnelEncoding::GetEncodedLength(lpWideCharStr, cchWideChar);
 
-    if (cbMultiByte > 0)
+    int numChars = SjisTunnelEncoding::Encode(lpWideCharStr, cchWideChar, lpMultiByteStr, cbMultiByte);
+    if (numChars > cbMultiByte)
     {
-        memcpy(lpMultiByteStr, str.c_str(), min(numChars, cbMultiByte));
-        if (cbMultiByte < numChars)
-        {
-            SetLastError(ERROR_INSUFFICIENT_BUFFER);
-            return 0;
-        }
+        SetLastError(ERROR_INSUFFICIENT_BUFFER);
+        return 0;
     }
 
     return numChars;
@@ -62,6 +62,11 @@ void Initialize()
     SetCurrentDirectoryW(Path::GetModuleFolderPath(nullptr).c_str());
     RuntimeConfig::Load();
 
+    // Collect the byte patterns that the subsystems below look for, so that the image only needs to be scanned once
+    CompilerHelper::RegisterSignatures();
+//    SjisTunnelEncoding::RegisterSignatures();
+    SignatureScanner::Scan();
+
     CompilerHelper::Init();
     Win32AToWAdapter::Init();
 //    SjisTunnelEncoding::PatchGameLookupTable();
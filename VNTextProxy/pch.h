@@ -15,21 +15,32 @@
 #include <Mmreg.h>
 #include <msctf.h>
 #include <MSAcm.h>
+#include <usp10.h>
 
+#include <atomic>
+#include <bit>
+#include <bitset>
 #include <codecvt>
 #include <cstdlib>
+#include <deque>
 #include <algorithm>
 #include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <ranges>
 #include <set>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <sstream>
+#include <stdexcept>
 #include <vector>
 
 #include "../external/Detours/detours.h"
 
 #include "Util/ComPtr.h"
+#include "Util/Cp932.h"
 #include "Util/Path.h"
 #include "Util/membuf.h"
 #include "Util/MemoryUtil.h"
@@ -38,8 +49,11 @@
 #include "Util/RuntimeConfig.h"
 
 #include "PE/PE.h"
+#include "PE/SignatureCache.h"
+#include "PE/SignatureScanner.h"
 
 #include "CompilerSpecific/Enumerations.h"
+#include "CompilerSpecific/RttiIndex.h"
 #include "CompilerSpecific/CompilerHelper.h"
 #include "CompilerSpecific/Rtti/BorlandTypeDescriptor.h"
 #include "CompilerSpecific/Rtti/MsvcRttiCompleteObjectLocator.h"
@@ -53,9 +67,12 @@
 
 #include "Proxy.h"
 #include "ImportHooker.h"
+#include "KerningTable.h"
 #include "Font.h"
 #include "FontManager.h"
+#include "GlyphCache.h"
 #include "SjisTunnelEncoding.h"
+#include "PalTextTokenizer.h"
 #include "Win32AToWAdapter.h"
 #include "Proportionalizer.h"
 #include "GdiProportionalizer.h"
@@ -28,3 +28,4 @@ for /D %%p in (VNTextProxy\AlternateProxies\*) do (
     copy /Y VNTextProxy\Release\%%~np.dll Build\VNTextProxy
     rmdir /S /Q VNTextProxy\Release
 )
+rmdir /S /Q VNTextProxy\ShaderGen\Release